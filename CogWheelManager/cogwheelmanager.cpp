@@ -42,6 +42,7 @@ CogWheelManager::CogWheelManager(QObject *parent) : QLocalServer(parent)
     m_controllerCommandTable.insert(kCWCommandSTATUS, &CogWheelManager::serverStatus);
     m_controllerCommandTable.insert(kCWCommandCONNECTIONS, &CogWheelManager::connectionList);
     m_controllerCommandTable.insert(kCWCommandLOGOUTPUT,&CogWheelManager::logOutput);
+    m_controllerCommandTable.insert(kCWCommandSTATISTICS,&CogWheelManager::serverStatistics);
 
 }
 
@@ -424,6 +425,23 @@ void CogWheelManager::connectionList(QDataStream &input)
 
 }
 
+/**
+ * @brief CogWheelManager::serverStatistics
+ *
+ * Server statistics command recieved from controller.
+ *
+ * @param input
+ */
+void CogWheelManager::serverStatistics(QDataStream &input)
+{
+    QStringList statistics;
+
+    input >> statistics;
+
+    emit statisticsUpdate(statistics);
+
+}
+
 /**
  * @brief CogWheelManager::logOutput
  *
@@ -85,6 +85,7 @@ public:
     void serverStatus(QDataStream &input);
     void connectionList(QDataStream &input);
     void logOutput(QDataStream &input);
+    void serverStatistics(QDataStream &input);
 
     // Private data accessors
 
@@ -119,6 +120,7 @@ signals:
     void serverStatusUpdate(const QString &status);
     void connectionListUpdate(const QStringList &connections);
     void logWindowUpdate(const QStringList &logBuffer);
+    void statisticsUpdate(const QStringList &statistics);
 
 public slots:
 
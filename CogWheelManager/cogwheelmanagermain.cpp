@@ -63,6 +63,7 @@ CogWheelManagerMain::CogWheelManagerMain(QWidget *parent) :
     connect(&m_serverManager,&CogWheelManager::serverStatusUpdate, this, &CogWheelManagerMain::serverStatusUpdate);
     connect(&m_serverManager,&CogWheelManager::connectionListUpdate, this, &CogWheelManagerMain::connectionListUpdate);
     connect(&m_serverManager,&CogWheelManager::logWindowUpdate, this, &CogWheelManagerMain::logWindowUpdate);
+    connect(&m_serverManager,&CogWheelManager::statisticsUpdate, this, &CogWheelManagerMain::statisticsUpdate);
 
     ui->logListView->setModel(&m_serverLoggingBuffer);
 
@@ -239,6 +240,19 @@ void CogWheelManagerMain::connectionListUpdate(const QStringList &connections)
 
 }
 
+/**
+ * @brief CogWheelManagerMain::statisticsUpdate
+ *
+ * Show server statistics sent by controller as the
+ * connection list tooltip.
+ *
+ * @param statistics
+ */
+void CogWheelManagerMain::statisticsUpdate(const QStringList &statistics)
+{
+    ui->connectionList->setToolTip(statistics.join("\n"));
+}
+
 /**
  * @brief CogWheelManagerLoggingDialog::logWindowUpdate
  *
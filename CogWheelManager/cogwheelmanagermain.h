@@ -79,6 +79,7 @@ private slots:
     void serverStatusUpdate(const QString status);
     void connectionListUpdate(const QStringList &connections);
     void logWindowUpdate(const QStringList &logBuffer);
+    void statisticsUpdate(const QStringList &statistics);
 
 private:
 
@@ -39,6 +39,7 @@ constexpr const char *kCWCommandSTART        { "START" };
 constexpr const char *kCWCommandSTOP         { "STOP" };
 constexpr const char *kCWCommandKILL         { "KILL" };
 constexpr const char *kCWCommandLOGOUTPUT    { "LOGOUTPUT" };
+constexpr const char *kCWCommandSTATISTICS   { "STATISTICS" };
 
 // Status command replies
 
@@ -46,10 +47,91 @@ constexpr const char *kCWStatusSTOPPED       { "STOPPED" };
 constexpr const char *kCWStatusRUNNING       { "RUNNING" };
 constexpr const char *kCWStatusTERMINATED    { "TERMINATED" };
 
+// Maximum control channel command line length (excluding end of line)
+
+constexpr const int kCWMaxCommandLineLength=4096;
+
+// Maximum bytes of command lines held while a transfer is in progress
+
+constexpr const int kCWMaxHeldCommandBytes=64*1024;
+
+// FTP command table flags
+
+constexpr const quint32 kCWCommandNeedsAuth=0x1;     // User must be authorised
+constexpr const quint32 kCWCommandNeedsTLS=0x2;      // Only if TLS/SSL enabled
+constexpr const quint32 kCWCommandExtended=0x4;      // Command extension (FEAT)
+
+// Initial buffer size for control channel replies
+
+constexpr const int kCWReplyReserve=1024;
+
 // Write size for file downloads
 
 constexpr const quint64 kCWWriteBytesSize=1024*32;
 
+// Maximum bytes queued on a data channel socket for downloads
+
+constexpr const quint64 kCWWriteWindowSize=1024*256;
+
+// Download read ahead pool threads and blocks kept ready per download
+
+constexpr const int kCWReadAheadThreads=4;
+constexpr const int kCWReadAheadBlocks=2;
+
+// Maximum bytes passed to a single sendfile() call (Linux limit)
+
+constexpr const quint64 kCWSendFileMaxBytes=0x7ffff000;
+
+// Server global name address refresh seconds
+
+constexpr const int kCWGlobalNameRefresh=300;
+
+// Delay milliseconds after settings file change before user directory reload
+
+constexpr const int kCWUserDirectoryReloadDelay=500;
+
+// User/group id to name cache time to live seconds
+
+constexpr const int kCWIdNameCacheTTL=300;
+
+// Directory listing cache memory cap in bytes
+
+constexpr const quint64 kCWListingCacheSize=1024*1024*32;
+
+// Listing parallel stat pool threads (0 == stat entries sequentially)
+
+constexpr const int kCWListingStatThreads=0;
+
+// MLST/MLSD facts (selected per session with OPTS MLST)
+
+constexpr const quint32 kCWFactType=0x001;
+constexpr const quint32 kCWFactSize=0x002;
+constexpr const quint32 kCWFactModify=0x004;
+constexpr const quint32 kCWFactCreate=0x008;
+constexpr const quint32 kCWFactUnixMode=0x010;
+constexpr const quint32 kCWFactUnixOwner=0x020;
+constexpr const quint32 kCWFactUnixGroup=0x040;
+constexpr const quint32 kCWFactUnixOwnerName=0x080;
+constexpr const quint32 kCWFactUnixGroupName=0x100;
+constexpr const quint32 kCWFactAll=0x1ff;
+
+// Listing chunk capacity reserved beyond maximum chunk size (for last line)
+
+constexpr const int kCWListingLineReserve=1024;
+
+// Recursive listing directories prefetched (per listing) and bytes prefetched per directory
+
+constexpr const int kCWRecursiveListingPrefetch=4;
+constexpr const int kCWRecursiveListingPrefetchBytes=1024*256;
+
+// Recursive listing maximum directories waiting to be listed (listing fails if reached)
+
+constexpr const int kCWRecursiveListingMaxPending=16384;
+
+// Data channel connect/accept/TLS handshake timeout seconds
+
+constexpr const int kCWDataChannelTimeout=30;
+
 // Conenction list update timer milliseconds
 
 constexpr const quint64 kCWConnListUpdateTime=5000;
@@ -13,11 +13,11 @@
 // Class: CogWheelConnections
 //
 // Description: Class to accept new FTP connections from the
-// server, create an instance of  control channel, a new thread
-// to run the channel on and open the channel. The connection is
-// removed on the reciept of a signal to the finshedConnection slot
-// function which removes the connection from the list of current
-// connections.
+// server, create an instance of  control channel, assign it to the
+// least loaded of a fixed pool of connection threads and open the
+// channel. The connection is removed on the reciept of a signal to
+// the finshedConnection slot function which removes the connection
+// from the list of current connections.
 //
 
 // =============
@@ -26,6 +26,10 @@
 
 #include "cogwheelconnections.h"
 #include "cogwheellogger.h"
+#include "cogwheelpassiveports.h"
+#include "cogwheellistingcache.h"
+
+#include <QTcpSocket>
 
 // ====================
 // CLASS IMPLEMENTATION
@@ -46,12 +50,15 @@ CogWheelConnections::CogWheelConnections(QObject *parent) : QObject(parent)
 /**
  * @brief CogWheelConnections::~CogWheelConnections
  *
- * Destructor. Close all open connections.
+ * Destructor. Close all open connections and stop
+ * connection threads.
  *
  */
 CogWheelConnections::~CogWheelConnections()
 {
+    stopListeners();
     closeAll();
+    stopConnectionThreads();
 }
 
 /**
@@ -66,13 +73,163 @@ void CogWheelConnections::closeAll()
     resetConnectionListUpdateTimer();
 }
 
+/**
+ * @brief CogWheelConnections::startConnectionThreads
+ *
+ * Create and start the connection thread pool. Each thread runs an
+ * event loop shared by all of the control channels assigned to it.
+ *
+ */
+void CogWheelConnections::startConnectionThreads()
+{
+
+    int threadCount = m_serverSettings.serverConnectionThreads();
+
+    if (threadCount <= 0) {
+        threadCount = qMax(QThread::idealThreadCount(), 1);
+    }
+
+    for (int threadNo=0; threadNo < threadCount; threadNo++) {
+        QThread *connectionThread = new QThread();
+        if (connectionThread==nullptr) {
+            throw CogWheelConnections::Exception("Could not create thread for conenction pool.");
+        }
+        connectionThread->setObjectName("Connection "+QString::number(threadNo));
+        connectionThread->start();
+        m_connectionThreads.append(connectionThread);
+        m_threadConnectionCount.append(0);
+    }
+
+    cogWheelInfo("Connection thread pool started with "+QString::number(threadCount)+" threads.");
+
+}
+
+/**
+ * @brief CogWheelConnections::stopConnectionThreads
+ *
+ * Stop connection thread pool; waiting for each thread to finish.
+ *
+ */
+void CogWheelConnections::stopConnectionThreads()
+{
+
+    for (QThread *connectionThread : m_connectionThreads) {
+        connectionThread->quit();
+        connectionThread->wait();
+        delete connectionThread;
+    }
+
+    m_connectionThreads.clear();
+    m_threadConnectionCount.clear();
+    m_nextThread=0;
+
+}
+
+/**
+ * @brief CogWheelConnections::startListeners
+ *
+ * Start a SO_REUSEPORT listener on each connection thread so that
+ * connections are accepted (and their control channels opened) on the
+ * thread that will run them.
+ *
+ * @param port  Server port.
+ *
+ * @return  == true all listeners started.
+ */
+bool CogWheelConnections::startListeners(quint16 port)
+{
+
+    if (!CogWheelListener::isSupported()) {
+        return(false);
+    }
+
+    if (m_connectionThreads.isEmpty()) {
+        startConnectionThreads();
+    }
+
+    for (QThread *connectionThread : m_connectionThreads) {
+
+        CogWheelListener *listener = new CogWheelListener(m_serverSettings);
+
+        if (listener==nullptr) {
+            throw CogWheelConnections::Exception("Could not create listener object.");
+        }
+
+        listener->moveToThread(connectionThread);
+        connect(listener, &CogWheelListener::connectionOpened, this, &CogWheelConnections::registerConnection);
+        m_listeners.append(listener);
+
+        // Listening socket has to be created on listeners thread
+
+        bool listening=false;
+
+        QMetaObject::invokeMethod(listener, "startListening", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(bool, listening), Q_ARG(quint16, port));
+
+        if (!listening) {
+            stopListeners();
+            return(false);
+        }
+
+    }
+
+    return(true);
+
+}
+
+/**
+ * @brief CogWheelConnections::stopListeners
+ *
+ * Stop and delete any connection thread listeners.
+ *
+ */
+void CogWheelConnections::stopListeners()
+{
+
+    for (CogWheelListener *listener : m_listeners) {
+        QMetaObject::invokeMethod(listener, "stopListening", Qt::BlockingQueuedConnection);
+        listener->deleteLater();
+    }
+
+    m_listeners.clear();
+
+}
+
+/**
+ * @brief CogWheelConnections::leastLoadedThread
+ *
+ * Return index of connection thread with the fewest connections. The
+ * search starts after the last thread picked so that threads with the
+ * same load are used round robin.
+ *
+ * @return  Connection thread index.
+ */
+int CogWheelConnections::leastLoadedThread()
+{
+
+    int threadIndex = m_nextThread % m_connectionThreads.size();
+
+    for (int threadNo=1; threadNo < m_connectionThreads.size(); threadNo++) {
+        int candidate = (m_nextThread+threadNo) % m_connectionThreads.size();
+        if (m_threadConnectionCount[candidate] < m_threadConnectionCount[threadIndex]) {
+            threadIndex = candidate;
+        }
+    }
+
+    m_nextThread = threadIndex+1;
+
+    return(threadIndex);
+
+}
+
 /**
  * @brief CogWheelConnections::acceptConnection
  *
  * Accept incoming FTP client connection. Create a control channel
- * object, setup the signals/slots for communicating with it, create
- * a  thread and move the channel to it, store channel in the current
- * connections array  and open the control channel for receiving commands.
+ * object, setup the signals/slots for communicating with it, move the
+ * channel to the least loaded connection thread, store channel in the
+ * current connections array  and open the control channel for receiving
+ * commands.
  *
  * @param handle    Control socket handle.
  */
@@ -84,47 +241,74 @@ void CogWheelConnections::acceptConnection(qint64 handle)
         return;
     }
 
+    // Start connection threads on first connection
+
+    if (m_connectionThreads.isEmpty()) {
+        startConnectionThreads();
+    }
+
     // Use scope pointers to enable easy tidyup on error
 
     QScopedPointer<CogWheelControlChannel> connection { new CogWheelControlChannel(m_serverSettings) };
-    QScopedPointer<QThread> connectionThread { new QThread() };
 
     if (connection==nullptr) {
         throw CogWheelConnections::Exception("Could not create connection object.");
     }
 
-    if (connectionThread==nullptr) {
-        throw CogWheelConnections::Exception("Could not create thread for conenction.");
-    }
+    // Run control channel on least loaded connection thread.
 
-    // Create thread and run control channel on it.
+    int threadIndex = leastLoadedThread();
 
-    connection->setConnectionThread( connectionThread.take());
+    connection->setConnectionThread(m_connectionThreads[threadIndex]);
     connection->moveToThread(connection->connectionThread());
-    connection->connectionThread()->start();
 
-    // Store connection
+    // Store and open connection
 
-    m_connections[handle] = connection.take();
+    registerConnection(handle, connection.take());
 
-    // Disconnect any old open handlers
+}
 
-    disconnect(this, &CogWheelConnections::openConnection,0,0);
+/**
+ * @brief CogWheelConnections::registerConnection
+ *
+ * Store a control channel running on a connection thread in the current
+ * connections array, setup the signals/slots for communicating with it and
+ * then open it on its thread. Opening is queued only once the channel is
+ * registered so that its finished/aborted signals are always connected
+ * (even if the server is disabled or the client drops straight away).
+ * Called directly for connections accepted by the server and through a
+ * signal for those accepted by a connection thread listener.
+ *
+ * @param handle        Control socket handle.
+ * @param connection    Control channel (not yet opened).
+ */
+void CogWheelConnections::registerConnection(qint64 handle, CogWheelControlChannel *connection)
+{
 
-    // Setup slots
+    // Handle in use; close client socket and free channel
 
-    connect(this,&CogWheelConnections::openConnection, m_connections[handle], &CogWheelControlChannel::openConnection);
-    connect(m_connections[handle],&CogWheelControlChannel::finishedConnection,this, &CogWheelConnections::finishedConnection);
-    connect(m_connections[handle],&CogWheelControlChannel::abortedConnection,this, &CogWheelConnections::finishedConnection);
-    connect(this,&CogWheelConnections::closeAllConnections, m_connections[handle], &CogWheelControlChannel::closeConnection);
+    if (m_connections.contains(handle)) {
+        cogWheelError("Connection already being used");
+        QTcpSocket rejectedSocket;
+        if (rejectedSocket.setSocketDescriptor(handle)) {
+            rejectedSocket.abort();
+        }
+        connection->deleteLater();
+        return;
+    }
 
-    // Delete thread when it is finished
+    m_connections[handle] = connection;
 
-    connect(m_connections[handle]->connectionThread(),&QThread::finished,m_connections[handle]->connectionThread(), &QThread::deleteLater );
+    int threadIndex = m_connectionThreads.indexOf(connection->connectionThread());
+    if (threadIndex != -1) {
+        m_threadConnectionCount[threadIndex]++;
+    }
 
-    // Open control channel
+    // Setup slots
 
-    emit openConnection(handle);
+    connect(connection,&CogWheelControlChannel::finishedConnection,this, &CogWheelConnections::finishedConnection);
+    connect(connection,&CogWheelControlChannel::abortedConnection,this, &CogWheelConnections::finishedConnection);
+    connect(this,&CogWheelConnections::closeAllConnections, connection, &CogWheelControlChannel::closeConnection);
 
     cogWheelInfo("Number of active connections now: "+QString::number(m_connections.size()));
 
@@ -136,6 +320,10 @@ void CogWheelConnections::acceptConnection(qint64 handle)
         m_connectionListUpdateTimer->start(m_serverSettings.connectionListUpdateTime());
     }
 
+    // Open control channel on its thread
+
+    QMetaObject::invokeMethod(connection, "openConnection", Qt::QueuedConnection, Q_ARG(qint64, handle));
+
 }
 
 /**
@@ -157,6 +345,11 @@ void CogWheelConnections::finishedConnection(qint64 handle)
 
     CogWheelControlChannel *connection = m_connections[handle];
 
+    int threadIndex = m_connectionThreads.indexOf(connection->connectionThread());
+    if (threadIndex != -1) {
+        m_threadConnectionCount[threadIndex]--;
+    }
+
     m_connections.remove(handle);
     connection->deleteLater();
 
@@ -174,22 +367,50 @@ void CogWheelConnections::finishedConnection(qint64 handle)
 /**
  * @brief CogWheelConnections::connectionListToManager
  *
- * Send current connection list to manager.
+ * Send current connection list and per connection thread
+ * connection/transfer counts to manager. Connections run on other
+ * threads so only their thread safe list state is read.
  *
  */
 void CogWheelConnections::connectionListToManager()
 {
     QStringList connectionList;
+    QStringList statistics;
+    QVector<int> threadTransferCount(m_connectionThreads.size(), 0);
 
-    for( auto &connection : m_connections) {
-        if (connection->isAuthorized()) {
-            connectionList.append(connection->userName());
+    for (auto connection = m_connections.cbegin(); connection != m_connections.cend(); ++connection) {
+        QString userName { connection.value()->connectionListName() };
+        if (!userName.isEmpty()) {
+            connectionList.append(userName);
         } else {
-            connectionList.append(QString::number(connection->socketHandle()));
+            connectionList.append(QString::number(connection.key()));
+        }
+        int threadIndex = m_connectionThreads.indexOf(connection.value()->connectionThread());
+        if ((threadIndex != -1) && connection.value()->isDataChannelActive()) {
+            threadTransferCount[threadIndex]++;
         }
     }
 
+    for (int threadIndex=0; threadIndex < m_connectionThreads.size(); threadIndex++) {
+        QString threadStatistics { "Thread "+QString::number(threadIndex)+": "+
+                                   QString::number(m_threadConnectionCount[threadIndex])+" connections, "+
+                                   QString::number(threadTransferCount[threadIndex])+" transfers" };
+        if (threadIndex < m_listeners.size()) {
+            threadStatistics.append(", "+QString::number(m_listeners[threadIndex]->acceptCount())+" accepts");
+        }
+        statistics.append(threadStatistics);
+    }
+
+    if (CogWheelPassivePorts::getInstance().portCount()) {
+        statistics.append(CogWheelPassivePorts::getInstance().statistics());
+    }
+
+    if (CogWheelListingCache::getInstance().isEnabled()) {
+        statistics.append(CogWheelListingCache::getInstance().statistics());
+    }
+
     emit updateConnectionList(connectionList);
+    emit updateStatistics(statistics);
 
 }
 
@@ -16,11 +16,11 @@
 // Class: CogWheelConnections
 //
 // Description: Class to accept new FTP connections from the
-// server, create an instance of  control channel, a new thread
-// to run the channel on and open the channel. The connection is
-// removed on the reciept of a signal to the finshedConnection slot
-// function which removes the connection from the list of current
-// connections.
+// server, create an instance of  control channel, assign it to the
+// least loaded of a fixed pool of connection threads and open the
+// channel. The connection is removed on the reciept of a signal to
+// the finshedConnection slot function which removes the connection
+// from the list of current connections.
 //
 
 // =============
@@ -29,10 +29,13 @@
 
 #include "cogwheel.h"
 #include "cogwheelcontrolchannel.h"
+#include "cogwheellistener.h"
 #include "cogwheelserversettings.h"
 
 #include <QObject>
 #include <QTimer>
+#include <QThread>
+#include <QVector>
 
 // =================
 // CLASS DECLARATION
@@ -63,6 +66,11 @@ public:
 
     void closeAll();
 
+    // Start/stop SO_REUSEPORT listener per connection thread
+
+    bool startListeners(quint16 port);
+    void stopListeners();
+
     // Private data accessors
 
     CogWheelServerSettings serverSettings() const;
@@ -74,20 +82,27 @@ private:
 
     void resetConnectionListUpdateTimer();
 
+    // Connection thread pool
+
+    void startConnectionThreads();
+    void stopConnectionThreads();
+    int leastLoadedThread();
+
 signals:
 
-    // Open connection / close all connections
+    // Close all connections
 
-    void openConnection(qint64 handle);
     void closeAllConnections();
 
     // Connection list updates for controller
 
     void updateConnectionList(const QStringList &connections);
+    void updateStatistics(const QStringList &statistics);
 
 public slots:
 
     void acceptConnection(qint64 handle);   // Accept client connection
+    void registerConnection(qint64 handle, CogWheelControlChannel *connection); // Register and open connection
     void finishedConnection(qint64 handle); // Connection finished
     void abortedConnection(qint64 handle);  // Connection aborted
     void connectionListToManager();         // Send connection list to manager
@@ -96,6 +111,10 @@ private:
     QTimer *m_connectionListUpdateTimer=nullptr;            // Timer for sending connection updates to manager
     QMap<qint64, CogWheelControlChannel *> m_connections;   // Socket Handle connection mapping
     CogWheelServerSettings m_serverSettings;                // Server settings
+    QVector<QThread *> m_connectionThreads;                 // Connection thread pool
+    QVector<int> m_threadConnectionCount;                   // Connections per pool thread
+    int m_nextThread=0;                                     // Next thread to try (round robin)
+    QVector<CogWheelListener *> m_listeners;                // Listener per connection thread
 
 };
 #endif // COGWHEELCONNECTIONS_H
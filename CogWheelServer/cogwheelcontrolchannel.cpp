@@ -25,16 +25,15 @@
 #include "cogwheelcontrolchannel.h"
 #include "cogwheelftpcore.h"
 #include "cogwheellogger.h"
+#include "cogwheelpassiveports.h"
+#include "cogwheelglobaladdress.h"
+
+#include <cstring>
 
 // ====================
 // CLASS IMPLEMENTATION
 // ====================
 
-// Passive port map access mutex & currently active passive ports table
-
-QMutex CogWheelControlChannel::m_passiveMapMutex;
-QSet<quint64> CogWheelControlChannel::passivePortMap;
-
 /**
  * @brief CogWheelControlChannel::CogWheelControlChannel
  *
@@ -49,12 +48,14 @@ CogWheelControlChannel::CogWheelControlChannel(CogWheelServerSettings serverSett
     // Setup any control channel server settings
 
     setServerWriteBytesSize(serverSettings.serverWriteBytesSize());
-    setServerPrivateKey(serverSettings.serverPrivateKey());
-    setServerCert(serverSettings.serverCert());
+    setServerWriteWindowSize(serverSettings.serverWriteWindowSize());
+    setServerSslConfiguration(serverSettings.serverSslConfiguration());
     setServerEnabled(serverSettings.serverEnabled());
-    setServerGlobalIP(serverSettings.serverGlobalName());
+    setServerGlobalIP(CogWheelGlobalAddress::address());
     setServerPassivePortLow(serverSettings.serverPassivePortLow());
     setServerPassivePortHigh(serverSettings.serverPassivePortHigh());
+    setServerSendFileEnabled(serverSettings.serverSendFileEnabled());
+    setServerDataChannelTimeout(serverSettings.serverDataChannelTimeout());
 
 }
 
@@ -95,10 +96,14 @@ void CogWheelControlChannel::createDataChannel()
         throw CogWheelFtpServerReply(425);
     }
 
+    m_dataChannelActive.store(true);
+
     // Setup signals and slots for channel
 
     connect(m_dataChannel,&CogWheelDataChannel::transferFinished, this,&CogWheelControlChannel::transferFinished, Qt::DirectConnection);
+    connect(m_dataChannel,&CogWheelDataChannel::transferFailed, this,&CogWheelControlChannel::transferFailed, Qt::DirectConnection);
     connect(m_dataChannel, &CogWheelDataChannel::passiveConnection, this, &CogWheelControlChannel::passiveConnection, Qt::DirectConnection);
+    connect(m_dataChannel, &CogWheelDataChannel::connectFailed, this, &CogWheelControlChannel::dataChannelConnectFailed, Qt::DirectConnection);
 
 }
 
@@ -119,16 +124,22 @@ void CogWheelControlChannel::tearDownDataChannel()
     m_dataChannel->deleteLater();
     m_dataChannel = nullptr;
 
+    m_dataChannelActive.store(false);
+
 }
 
 /**
  * @brief CogWheelControlChannel::connectDataChannel
  *
- * Connect up data channel to client.
+ * Start connecting up data channel to client. The connect/accept
+ * and any TLS handshake complete asynchronously; any transfer
+ * requested in the meantime is queued until the channel is ready.
+ *
+ * @param isDownload    == true channel is for a file download (RETR).
  *
- * @return  true if sucessfully connected.
+ * @return  true if connection started.
  */
-bool CogWheelControlChannel::connectDataChannel()
+bool CogWheelControlChannel::connectDataChannel(bool isDownload)
 {
 
     // If data channel does not exist then send error to client
@@ -138,7 +149,13 @@ bool CogWheelControlChannel::connectDataChannel()
         return(false);
     }
 
-    return(m_dataChannel->connectToClient(this));
+    if (!m_dataChannel->connectToClient(this, isDownload)) {
+        return(false);
+    }
+
+    // Connect can fail straight away (channel torn down)
+
+    return(m_dataChannel != nullptr);
 
 }
 
@@ -180,6 +197,31 @@ void CogWheelControlChannel::disconnectDataChannel()
 
     tearDownDataChannel();
 
+    // Execute any commands held while transfer in progress
+
+    if (!m_readBuffer.isEmpty()) {
+        QMetaObject::invokeMethod(this, "processCommandLines", Qt::QueuedConnection);
+    }
+
+}
+
+/**
+ * @brief CogWheelControlChannel::finishOnDataChannel
+ *
+ * Close data channel once any data sent on it has been written;
+ * transferFinished() then replies to the client.
+ *
+ */
+void CogWheelControlChannel::finishOnDataChannel()
+{
+
+    if (m_dataChannel == nullptr) {
+        cogWheelWarning(socketHandle(),"Data channel not active.");
+        return;
+    }
+
+    m_dataChannel->finishTransfer();
+
 }
 
 /**
@@ -216,40 +258,26 @@ void CogWheelControlChannel::downloadFileFromDataChannel(const QString &file)
 /**
  * @brief CogWheelControlChannel::getPassivePort
  *
- * Return a random port from range if it is specified.
+ * Return a free port from range if one was set up (the shared port table
+ * is empty when the range is unset or invalid).
  *
- * @return
+ * @return  Passive port (0 == use any port).
  */
 quint64 CogWheelControlChannel::getPassivePort()
 {
-    quint64 passivePort=0;
 
-    // Range not set (return use any  port)
+    // No valid range set up (return use any port)
 
-    if (serverPassivePortLow()==0) {
+    if (CogWheelPassivePorts::getInstance().portCount()==0) {
         return(0);
     }
 
-    // Pick a random unused port and use.
+    quint64 passivePort = CogWheelPassivePorts::getInstance().acquire();
 
-    if (serverPassivePortHigh() >= serverPassivePortLow()) {
-
-        QMutexLocker    passivePortMapLock { &m_passiveMapMutex };
-
-        // All ports being used (return use any port)
-
-        if (passivePortMap.size()==(static_cast<int>(serverPassivePortHigh()-serverPassivePortLow()+1))) {
-            cogWheelError("Passive port table overflow");
-            return(0);
-        }
-
-        do {
-            qsrand(qrand());
-            passivePort = qrand() % ((serverPassivePortHigh() + 1) - serverPassivePortLow()) + serverPassivePortLow();
-        } while(passivePortMap.contains(passivePort));
-
-        passivePortMap.insert(passivePort);
+    // All ports being used (return use any port)
 
+    if (passivePort==0) {
+        cogWheelError("Passive port table overflow");
     }
 
     return(passivePort);
@@ -259,19 +287,13 @@ quint64 CogWheelControlChannel::getPassivePort()
 /**
  * @brief CogWheelControlChannel::removePassivePort
  *
- * Remove port from port map.
+ * Release port back to passive port range.
  *
  * @param passivePort
  */
 void CogWheelControlChannel::removePassivePort(quint64 passivePort)
 {
-
-    QMutexLocker    passivePortMapLock { &m_passiveMapMutex };
-
-    if (passivePort && passivePortMap.contains(passivePort)) {
-        passivePortMap.remove(passivePort);
-    }
-
+    CogWheelPassivePorts::getInstance().release(passivePort);
 }
 
 /**
@@ -290,6 +312,10 @@ void CogWheelControlChannel::listenForConnectionOnDataChannel()
 
     m_dataChannel->setClientHostPort(getPassivePort());
 
+    // Pick up any refresh of cached global IP
+
+    setServerGlobalIP(CogWheelGlobalAddress::address());
+
     // Listen for connections using either local IP or global IP though NAT.
 
     if (serverGlobalIP().isEmpty()) {
@@ -311,7 +337,7 @@ void CogWheelControlChannel::abortOnDataChannel()
 {
 
     if(m_dataChannel != nullptr) {
-        if(m_dataChannel->isConnected() || m_dataChannel->isListening()){
+        if(m_dataChannel->isConnected() || m_dataChannel->isConnecting() || m_dataChannel->isListening()){
             disconnectDataChannel();
         }
     }
@@ -321,35 +347,94 @@ void CogWheelControlChannel::abortOnDataChannel()
 /**
  * @brief CogWheelControlChannel::processFTPCommand
  *
- * Send FTP command and arguments to FTP Core.
+ * Send FTP command and arguments to FTP Core. The command line is parsed in
+ * place; the verb is packed into a command table key and the arguments are
+ * decoded into a buffer reused between commands so that once it has grown no
+ * allocation is needed (unless an argument contains non-ASCII characters).
  *
- * @param commandLine   FTP command line string.
+ * @param commandLine   FTP command line bytes (end of line removed).
+ * @param length        FTP command line length.
  */
-void CogWheelControlChannel::processFTPCommand(QString commandLine)
+void CogWheelControlChannel::processFTPCommand(const char *commandLine, int length)
 {
-    QString command;
-    QString arguments;
 
-    // Remove end of line
+    // Separate command and arguments
 
-    commandLine.chop(2);
+    const char *space = static_cast<const char *>(std::memchr(commandLine, ' ', length));
+    int verbLength = (space != nullptr) ? static_cast<int>(space-commandLine) : length;
 
-    // Separate command and arguments
+    quint32 verb = CogWheelFTPCore::parseVerb(commandLine, verbLength);
 
-    if (commandLine.contains(' ')) {
-        command = commandLine.mid(0, commandLine.indexOf(' '));
-        commandLine.remove(0, commandLine.indexOf(' ')+1);
-        arguments = commandLine;
-    } else {
-        command = commandLine;
+    if (verb == 0) {
+        QString command { QString::fromUtf8(commandLine, verbLength).toUpper() };
+        cogWheelError(socketHandle(), "Unsupported FTP command "+command+".");
+        sendReplyCode(500, "Unsupported FTP command "+command+".");
+        return;
+    }
+
+    const char *arguments = (space != nullptr) ? space+1 : commandLine+length;
+    int argumentsLength = static_cast<int>((commandLine+length)-arguments);
+
+    m_commandArguments.resize(argumentsLength);
+
+    QChar *argument = m_commandArguments.data();
+    for (int index=0; index < argumentsLength; index++) {
+        if (static_cast<quint8>(arguments[index]) >= 0x80) {
+            m_commandArguments = QString::fromUtf8(arguments, argumentsLength);
+            break;
+        }
+        argument[index] = QLatin1Char(arguments[index]);
     }
 
-    // Perform command (converting to uppercase)
+    // Perform command
+
+    CogWheelFTPCore::performCommand(this, verb, m_commandArguments);
 
-    CogWheelFTPCore::performCommand(this, command.toUpper(), arguments);
+}
+
+/**
+ * @brief CogWheelControlChannel::isTransferInProgress
+ *
+ * @return  == true data channel connecting or connected for a transfer.
+ */
+bool CogWheelControlChannel::isTransferInProgress() const
+{
+    return((m_dataChannel != nullptr) && (m_dataChannel->isConnected() || m_dataChannel->isConnecting()));
+}
+
+/**
+ * @brief CogWheelControlChannel::updateConnectionListName
+ *
+ * Keep a copy of the name shown in the manager connection list (the user
+ * name once authorised) that the connections thread can read under a lock.
+ *
+ */
+void CogWheelControlChannel::updateConnectionListName()
+{
+    QMutexLocker nameLock { &m_connectionListNameMutex };
+    m_connectionListName = m_authorized ? m_userName : QString();
+}
 
+/**
+ * @brief CogWheelControlChannel::connectionListName
+ *
+ * @return  User name if authorised (empty if not).
+ */
+QString CogWheelControlChannel::connectionListName() const
+{
+    QMutexLocker nameLock { &m_connectionListNameMutex };
+    return(m_connectionListName);
 }
 
+/**
+ * @brief CogWheelControlChannel::isDataChannelActive
+ *
+ * @return  == true connection has a data channel (read atomically).
+ */
+bool CogWheelControlChannel::isDataChannelActive() const
+{
+    return(m_dataChannelActive.load());
+}
 
 /**
  * @brief CogWheelControlChannel::openConnection
@@ -382,6 +467,14 @@ void CogWheelControlChannel::openConnection(qint64 socketHandle)
         return;
     }
 
+    // Replies are sent whole with a single write so send them straight away
+
+    m_controlChannelSocket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+    // Command lines are read straight into a buffer kept for the connection
+
+    m_readBuffer.reserve(kCWMaxCommandLineLength+1);
+
     // Get client and server IP address.
 
     m_clientHostIP = static_cast<QHostAddress>(m_controlChannelSocket->peerAddress().toIPv4Address()).toString();
@@ -464,6 +557,35 @@ void CogWheelControlChannel::transferFinished()
     sendReplyCode(226);
 }
 
+/**
+ * @brief CogWheelControlChannel::transferFailed
+ *
+ * File transfer failed part way through (data connection aborted) so
+ * tear down data channel and send failure response to client.
+ *
+ * @param replyCode     Failure reply code.
+ * @param message       Failure message.
+ */
+void CogWheelControlChannel::transferFailed(quint16 replyCode, const QString &message)
+{
+    disconnectDataChannel();
+    sendReplyCode(replyCode, message);
+}
+
+/**
+ * @brief CogWheelControlChannel::dataChannelConnectFailed
+ *
+ * Data channel failed to connect, accept or complete its TLS handshake
+ * (or timed out doing so) so tear it down and reply to the client.
+ *
+ * @param message   Failure message.
+ */
+void CogWheelControlChannel::dataChannelConnectFailed(const QString &message)
+{
+    disconnectDataChannel();
+    sendReplyCode(425, message);
+}
+
 /**
  * @brief CogWheelControlChannel::passiveConnection
  *
@@ -487,23 +609,21 @@ void CogWheelControlChannel::passiveConnection()
  * @brief CogWheelControlChannel::enbleTLSSupport
  *
  * Enable TLS support for on SSL socket as an AUTH TLS command has been sent.
+ * Any commands already read after it were sent in the clear so they are
+ * thrown away rather than run as if protected by TLS.
  *
  */
 void CogWheelControlChannel::enbleTLSSupport()
 {
 
-    // Use ony secure protocols
-
-    m_controlChannelSocket->setProtocol(QSsl::SecureProtocols);
+    m_readBuffer.truncate(0);
+    m_readPosition = 0;
+    m_discardingLine = false;
+    m_readBufferReset = true;
 
-    // Create QSsl private key and cert
+    // Use shared secure protocols/private key/cert configuration
 
-    QSslKey sslPrivateKey(m_serverPrivateKey, QSsl::Rsa, QSsl::Pem, QSsl::PrivateKey);
-    QSslCertificate sslCert(m_serverCert);
-
-    m_controlChannelSocket->addCaCertificate(sslCert);
-    m_controlChannelSocket->setLocalCertificate(sslCert);
-    m_controlChannelSocket->setPrivateKey(sslPrivateKey);
+    m_controlChannelSocket->setSslConfiguration(m_serverSslConfiguration);
 
     // Hookup error and channel encypted signals
 
@@ -559,12 +679,11 @@ void CogWheelControlChannel::controlChannelEncrypted()
 void CogWheelControlChannel::sendReplyCode(quint16 replyCode,const QString &message)
 {
 
-    // Convert reply code to string, append message, send and flush.
+    CogWheelReplyBuilder reply;
 
-    QString reply { QString::number(replyCode) + " " + message};
+    reply.appendReplyCode(replyCode, message);
 
-    sendOnControlChannel(reply);
-    m_controlChannelSocket->flush();
+    sendReply(reply);
 
 }
 
@@ -577,24 +696,65 @@ void CogWheelControlChannel::sendReplyCode(quint16 replyCode,const QString &mess
  */
 void CogWheelControlChannel::sendReplyCode(quint16 replyCode)
 {
-    sendReplyCode(replyCode, CogWheelFTPCore::getResponseText(replyCode));
+
+    // Send pre-encoded reply if the code has one
+
+    QByteArray reply { CogWheelFTPCore::getResponseBytes(replyCode) };
+
+    if (!reply.isEmpty()) {
+        writeReply(reply);
+    } else {
+        sendReplyCode(replyCode, "");
+    }
+
+}
+
+/**
+ * @brief CogWheelControlChannel::sendReply
+ *
+ * Send a complete assembled reply to client over control channel.
+ *
+ * @param reply     Reply to send.
+ */
+void CogWheelControlChannel::sendReply(const CogWheelReplyBuilder &reply)
+{
+    writeReply(reply.reply());
 }
 
 /**
- * @brief CogWheelControlChannel::sendOnControlChannel
+ * @brief CogWheelControlChannel::replyBuffer
  *
- * Send data string on control channel to client.
+ * Reply buffer kept for the life of the connection so that frequent replies
+ * can be assembled without allocating. It must be sent before any other
+ * reply is built with it.
  *
- * @param dataToSend    Data to send over control channel.
+ * @return  Empty reply buffer.
  */
-void CogWheelControlChannel::sendOnControlChannel(const QString &dataToSend)
+CogWheelReplyBuilder &CogWheelControlChannel::replyBuffer()
 {
+    m_replyBuffer.clear();
+    return(m_replyBuffer);
+}
 
-    // Convert QString to bytes appending end of line
+/**
+ * @brief CogWheelControlChannel::writeReply
+ *
+ * Write reply bytes to client over control channel with a single write
+ * and flush.
+ *
+ * @param reply     Reply bytes (UTF-8 with end of line).
+ */
+void CogWheelControlChannel::writeReply(const QByteArray &reply)
+{
 
-    m_controlChannelSocket->write((dataToSend+kCWEOL).toUtf8().data());
+    m_controlChannelSocket->write(reply);
+    m_controlChannelSocket->flush();
+
+    // Only convert reply for log if it is going to be logged
 
-    cogWheelCommandReply(socketHandle(), dataToSend);
+    if (getLoggingLevel() & CogWheelLogger::CommandReply) {
+        cogWheelCommandReply(socketHandle(), QString::fromUtf8(reply).trimmed());
+    }
 
 }
 
@@ -608,7 +768,28 @@ void CogWheelControlChannel::sendOnControlChannel(const QString &dataToSend)
 void CogWheelControlChannel::sendOnDataChannel(const QByteArray &dataToSend)
 {
 
-    m_dataChannel->dataChannelSocket()->write(dataToSend);
+    m_dataChannel->sendData(dataToSend);
+
+}
+
+/**
+ * @brief CogWheelControlChannel::listOnDataChannel
+ *
+ * Send directory listing over data channel and close it once
+ * sent; transferFinished() then replies to the client.
+ *
+ * @param listing   Directory listing producer (data channel takes ownership).
+ */
+void CogWheelControlChannel::listOnDataChannel(CogWheelDirectoryListing *listing)
+{
+
+    if (m_dataChannel == nullptr) {
+        cogWheelWarning(socketHandle(),"Data channel not active.");
+        delete listing;
+        return;
+    }
+
+    m_dataChannel->sendListing(listing);
 
 }
 
@@ -647,14 +828,151 @@ void CogWheelControlChannel::disconnected()
 void CogWheelControlChannel::readyRead()
 {
 
-    // Read all available data and append to read buffer
-    // When end of line found execute command and clear buffer.
+    // Read all available data onto the end of the read buffer (no
+    // intermediate copy) then execute any complete command lines.
 
-    m_readBuffer.append(m_controlChannelSocket->readAll());
+    qint64 bytesAvailable = m_controlChannelSocket->bytesAvailable();
 
-    if (m_readBuffer.endsWith('\n')) {
-        processFTPCommand(m_readBuffer);
-        m_readBuffer.clear();
+    if (bytesAvailable > 0) {
+        int readSize = m_readBuffer.size();
+        m_readBuffer.resize(readSize+static_cast<int>(bytesAvailable));
+        qint64 bytesRead = m_controlChannelSocket->read(m_readBuffer.data()+readSize, bytesAvailable);
+        m_readBuffer.resize(readSize+static_cast<int>(qMax(bytesRead, Q_INT64_C(0))));
+    }
+
+    processCommandLines();
+
+}
+
+/**
+ * @brief CogWheelControlChannel::processCommandLines
+ *
+ * Execute every complete command line (LF or CRLF terminated) in the read
+ * buffer in order, keeping any partial line for the next read so pipelined
+ * commands are neither merged nor delayed. While a data transfer is in
+ * progress only ABOR, STAT and QUIT are executed (even if queued behind
+ * other commands); the rest are held in order until the transfer completes
+ * (the data channel being disconnected re-invokes this). Lines longer than
+ * the maximum are rejected and discarded. A client that sends more than can
+ * be held gets a 421 and is disconnected. Processing stops if a command
+ * resets the read buffer (AUTH TLS).
+ *
+ */
+void CogWheelControlChannel::processCommandLines()
+{
+
+    int scanPosition = m_readPosition;  // Next line to look at (any held lines are before it)
+
+    m_readBufferReset = false;
+
+    while (isConnected()) {
+
+        // Transfer over so go back to first held line to keep order
+
+        if ((scanPosition != m_readPosition) && !isTransferInProgress()) {
+            scanPosition = m_readPosition;
+        }
+
+        int endOfLine = m_readBuffer.indexOf('\n', scanPosition);
+
+        // Partial line; discard it if already too long
+
+        if (endOfLine == -1) {
+            if ((m_readBuffer.size()-scanPosition) > kCWMaxCommandLineLength) {
+                if (!m_discardingLine) {
+                    sendReplyCode(500, "Command line too long.");
+                    m_discardingLine = true;
+                }
+                m_readBuffer.truncate(scanPosition);
+            }
+            break;
+        }
+
+        const char *commandLine = m_readBuffer.constData()+scanPosition;
+        int length = endOfLine-scanPosition;
+
+        // Tail of over long line
+
+        if (m_discardingLine) {
+            m_discardingLine = false;
+            consumeCommandLine(scanPosition, endOfLine);
+            continue;
+        }
+
+        if ((length > 0) && (commandLine[length-1] == '\r')) {
+            length--;
+        }
+
+        // Skip any telnet IP/Synch sent ahead of ABOR
+
+        while ((length > 1) && (static_cast<quint8>(commandLine[0]) == 0xFF)) {
+            commandLine += 2;
+            length -= 2;
+        }
+        if ((length > 0) && (static_cast<quint8>(commandLine[0]) == 0xF2)) {
+            commandLine++;
+            length--;
+        }
+
+        // Hold command until current transfer complete and look at next
+
+        if (isTransferInProgress()) {
+            const char *space = static_cast<const char *>(std::memchr(commandLine, ' ', length));
+            quint32 verb = CogWheelFTPCore::parseVerb(commandLine, (space != nullptr) ? static_cast<int>(space-commandLine) : length);
+            if ((verb != CogWheelFTPCore::packVerb("ABOR")) && (verb != CogWheelFTPCore::packVerb("STAT")) &&
+                (verb != CogWheelFTPCore::packVerb("QUIT"))) {
+                if ((endOfLine+1-m_readPosition) > kCWMaxHeldCommandBytes) {
+                    cogWheelError(socketHandle(), "Too many commands held during transfer.");
+                    sendReplyCode(421, "Too many commands sent during transfer.");
+                    disconnectDataChannel();
+                    closeConnection();
+                    m_readBuffer.clear();
+                    m_readPosition = 0;
+                    return;
+                }
+                scanPosition = endOfLine+1;
+                continue;
+            }
+        }
+
+        if (length > kCWMaxCommandLineLength) {
+            sendReplyCode(500, "Command line too long.");
+        } else if (length > 0) {
+            processFTPCommand(commandLine, length);
+            if (m_readBufferReset) {
+                return;
+            }
+        }
+
+        consumeCommandLine(scanPosition, endOfLine);
+
+    }
+
+    // Remove processed lines from buffer
+
+    m_readBuffer.remove(0, m_readPosition);
+    m_readPosition = 0;
+
+}
+
+/**
+ * @brief CogWheelControlChannel::consumeCommandLine
+ *
+ * Finished with command line in read buffer. If no lines are being held
+ * before it then just move past it otherwise remove it from the buffer
+ * leaving the held lines in place.
+ *
+ * @param scanPosition  Start of line (returned as start of next).
+ * @param endOfLine     Position of line end (LF).
+ */
+void CogWheelControlChannel::consumeCommandLine(int &scanPosition, int endOfLine)
+{
+
+    if (scanPosition == m_readPosition) {
+        m_readPosition = endOfLine+1;
+        scanPosition = m_readPosition;
+    } else {
+        m_readBuffer.remove(scanPosition, endOfLine+1-scanPosition);
     }
 
 }
@@ -674,6 +992,60 @@ void CogWheelControlChannel::bytesWritten(qint64 numberOfBytes)
 // CLASS PRIVATE DATA ACCESSORS
 // ============================
 
+/**
+ * @brief CogWheelControlChannel::serverSendFileEnabled
+ * @return
+ */
+bool CogWheelControlChannel::serverSendFileEnabled() const
+{
+    return m_serverSendFileEnabled;
+}
+
+/**
+ * @brief CogWheelControlChannel::setServerSendFileEnabled
+ * @param serverSendFileEnabled
+ */
+void CogWheelControlChannel::setServerSendFileEnabled(bool serverSendFileEnabled)
+{
+    m_serverSendFileEnabled = serverSendFileEnabled;
+}
+
+/**
+ * @brief CogWheelControlChannel::serverDataChannelTimeout
+ * @return
+ */
+int CogWheelControlChannel::serverDataChannelTimeout() const
+{
+    return m_serverDataChannelTimeout;
+}
+
+/**
+ * @brief CogWheelControlChannel::setServerDataChannelTimeout
+ * @param serverDataChannelTimeout
+ */
+void CogWheelControlChannel::setServerDataChannelTimeout(int serverDataChannelTimeout)
+{
+    m_serverDataChannelTimeout = serverDataChannelTimeout;
+}
+
+/**
+ * @brief CogWheelControlChannel::mlstFacts
+ * @return
+ */
+quint32 CogWheelControlChannel::mlstFacts() const
+{
+    return m_mlstFacts;
+}
+
+/**
+ * @brief CogWheelControlChannel::setMLSTFacts
+ * @param mlstFacts
+ */
+void CogWheelControlChannel::setMLSTFacts(quint32 mlstFacts)
+{
+    m_mlstFacts = mlstFacts;
+}
+
 /**
  * @brief CogWheelControlChannel::serverPassivePortHigh
  * @return
@@ -722,18 +1094,13 @@ QString CogWheelControlChannel::serverGlobalIP() const
 /**
  * @brief CogWheelControlChannel::setServerGlobalIP
  *
- * Converts server global name into IP address with use with passive mode through a NAT.
+ * Set server global IP address for use with passive mode through a NAT.
  *
- * @param serverGlobalName
+ * @param serverGlobalIP
  */
-void CogWheelControlChannel::setServerGlobalIP(const QString &serverGlobalName)
+void CogWheelControlChannel::setServerGlobalIP(const QString &serverGlobalIP)
 {
-    m_serverGlobalIP = m_serverIP;
-    QHostInfo info = QHostInfo::fromName(serverGlobalName);
-    if (!info.addresses().isEmpty()) {
-        QHostAddress address { info.addresses().first().toIPv4Address() };
-        m_serverGlobalIP = static_cast<QHostAddress>(info.addresses().first().toIPv4Address()).toString();
-    }
+    m_serverGlobalIP = serverGlobalIP;
 }
 
 /**
@@ -755,39 +1122,21 @@ void CogWheelControlChannel::setServerEnabled(bool serverEnabled)
 }
 
 /**
- * @brief CogWheelControlChannel::serverCert
+ * @brief CogWheelControlChannel::serverSslConfiguration
  * @return
  */
-QByteArray CogWheelControlChannel::serverCert() const
-{
-    return m_serverCert;
-}
-
-/**
- * @brief CogWheelControlChannel::setServerCert
- * @param serverCert
- */
-void CogWheelControlChannel::setServerCert(const QByteArray &serverCert)
+QSslConfiguration CogWheelControlChannel::serverSslConfiguration() const
 {
-    m_serverCert = serverCert;
+    return m_serverSslConfiguration;
 }
 
 /**
- * @brief CogWheelControlChannel::serverPrivateKey
- * @return
+ * @brief CogWheelControlChannel::setServerSslConfiguration
+ * @param serverSslConfiguration
  */
-QByteArray CogWheelControlChannel::serverPrivateKey() const
+void CogWheelControlChannel::setServerSslConfiguration(const QSslConfiguration &serverSslConfiguration)
 {
-    return m_serverPrivateKey;
-}
-
-/**
- * @brief CogWheelControlChannel::setServerPrivateKey
- * @param serverPrivateKey
- */
-void CogWheelControlChannel::setServerPrivateKey(const QByteArray &serverPrivateKey)
-{
-    m_serverPrivateKey = serverPrivateKey;
+    m_serverSslConfiguration = serverSslConfiguration;
 }
 
 /**
@@ -858,6 +1207,24 @@ void CogWheelControlChannel::setServerWriteBytesSize(const qint64 &writeBytesSiz
     m_serverWriteBytesSize = writeBytesSize;
 }
 
+/**
+ * @brief CogWheelControlChannel::serverWriteWindowSize
+ * @return
+ */
+qint64 CogWheelControlChannel::serverWriteWindowSize() const
+{
+    return m_serverWriteWindowSize;
+}
+
+/**
+ * @brief CogWheelControlChannel::setServerWriteWindowSize
+ * @param serverWriteWindowSize
+ */
+void CogWheelControlChannel::setServerWriteWindowSize(const qint64 &serverWriteWindowSize)
+{
+    m_serverWriteWindowSize = serverWriteWindowSize;
+}
+
 /**
  * @brief CogWheelControlChannel::transTypeByteSize
  * @return
@@ -1183,6 +1550,7 @@ bool CogWheelControlChannel::isAuthorized() const
 void CogWheelControlChannel::setAuthorized(bool authorized)
 {
     m_authorized = authorized;
+    updateConnectionListName();
 }
 
 /**
@@ -1224,6 +1592,17 @@ void CogWheelControlChannel::setCurrentWorkingDirectory(const QString &currentWo
         m_currentWorkingDirectory.append('/');
     }
 
+    m_currentWorkingDirectoryUtf8 = m_currentWorkingDirectory.toUtf8();
+
+}
+
+/**
+ * @brief CogWheelControlChannel::currentWorkingDirectoryUtf8
+ * @return
+ */
+QByteArray CogWheelControlChannel::currentWorkingDirectoryUtf8() const
+{
+    return m_currentWorkingDirectoryUtf8;
 }
 
 /**
@@ -1242,6 +1621,7 @@ QString CogWheelControlChannel::userName() const
 void CogWheelControlChannel::setUserName(const QString &user)
 {
     m_userName = user;
+    updateConnectionListName();
 }
 
 /**
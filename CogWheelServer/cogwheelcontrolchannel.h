@@ -28,14 +28,17 @@
 #include "cogwheel.h"
 #include "cogwheeldatachannel.h"
 #include "cogwheelserversettings.h"
+#include "cogwheelreplybuilder.h"
 
 #include <QObject>
 #include <QSslSocket>
 #include <QSslCertificate>
 #include <QSslKey>
+#include <QSslConfiguration>
 #include <QThread>
 #include <QHostInfo>
 #include <QMutex>
+#include <QAtomicInteger>
 
 // =================
 // CLASS DECLARATION
@@ -69,25 +72,36 @@ public:
 
     // Data channel functions
 
-    bool connectDataChannel();
+    bool connectDataChannel(bool isDownload=false);
     void uploadFileToDataChannel(const QString &file);
     void disconnectDataChannel();
+    void finishOnDataChannel();
     void setHostPortForDataChannel(const QStringList &ipAddressAndPort);
     void downloadFileFromDataChannel(const QString &file);
     void listenForConnectionOnDataChannel();
     void abortOnDataChannel();
     void sendOnDataChannel(const QByteArray &dataToSend);
+    void listOnDataChannel(CogWheelDirectoryListing *listing);
 
     // Control channel send response code+message and data functions
 
     void sendReplyCode(quint16 replyCode, const QString &message);
     void sendReplyCode(quint16 replyCode);
-    void sendOnControlChannel(const QString &dataToSend);
+    void sendReply(const CogWheelReplyBuilder &reply);
+
+    // Reply buffer reused between replies (returned empty)
+
+    CogWheelReplyBuilder &replyBuffer();
 
     // TLS support
 
     void enbleTLSSupport();
 
+    // Connection list state (safe to read from the connections thread)
+
+    QString connectionListName() const;
+    bool isDataChannelActive() const;
+
     // Private data accessors
 
     QString password() const;
@@ -96,6 +110,7 @@ public:
     void setUserName(const QString &userName);
     QString currentWorkingDirectory() const;
     void setCurrentWorkingDirectory(const QString &currentWorkingDirectory);
+    QByteArray currentWorkingDirectoryUtf8() const;
     bool isPassive() const;
     void setPassive(bool isPassive);
     bool isAuthorized() const;
@@ -136,16 +151,16 @@ public:
     void setTransTypeByteSize(const qint16 &transTypeByteSize);
     qint64 serverWriteBytesSize() const;
     void setServerWriteBytesSize(const qint64 &serverWriteBytesSize);
+    qint64 serverWriteWindowSize() const;
+    void setServerWriteWindowSize(const qint64 &serverWriteWindowSize);
     bool writeAccess() const;
     void setWriteAccess(bool writeAccess);
     bool IsSslConnection() const;
     void setSslConnection(bool sslConnection);
     QChar dataChanelProtection() const;
     void setDataChanelProtection(const QChar &dataChanelProtection);
-    QByteArray serverPrivateKey() const;
-    void setServerPrivateKey(const QByteArray &serverPrivateKey);
-    QByteArray serverCert() const;
-    void setServerCert(const QByteArray &serverCert);
+    QSslConfiguration serverSslConfiguration() const;
+    void setServerSslConfiguration(const QSslConfiguration &serverSslConfiguration);
     bool serverEnabled() const;
     void setServerEnabled(bool serverEnabled);
     QString serverGlobalIP() const;
@@ -154,12 +169,34 @@ public:
     void setServerPassivePortLow(const quint64 &serverPassivePortLow);
     quint64 serverPassivePortHigh() const;
     void setServerPassivePortHigh(const quint64 &serverPassivePortHigh);
+    bool serverSendFileEnabled() const;
+    void setServerSendFileEnabled(bool serverSendFileEnabled);
+    int serverDataChannelTimeout() const;
+    void setServerDataChannelTimeout(int serverDataChannelTimeout);
+    quint32 mlstFacts() const;
+    void setMLSTFacts(quint32 mlstFacts);
 
 private:
 
     // Process FTP command
 
-    void processFTPCommand(QString commandLine);
+    void processFTPCommand(const char *commandLine, int length);
+
+    // Finished with command line in read buffer
+
+    void consumeCommandLine(int &scanPosition, int endOfLine);
+
+    // Data channel transfer in progress
+
+    bool isTransferInProgress() const;
+
+    // Update connection list name after login change
+
+    void updateConnectionListName();
+
+    // Write complete reply to control channel
+
+    void writeReply(const QByteArray &reply);
 
     // Passive port allocation/deallocation.
 
@@ -183,7 +220,9 @@ public slots:
     // Data channel
 
     void transferFinished();            // File transfer finished
+    void transferFailed(quint16 replyCode, const QString &message); // File transfer failed
     void passiveConnection();           // Passive connection
+    void dataChannelConnectFailed(const QString &message); // Connect/accept failed
 
     // Control channel socket
 
@@ -191,6 +230,7 @@ public slots:
     void disconnected();
     void readyRead();
     void bytesWritten(qint64 numberOfBytes);
+    void processCommandLines();         // Dispatch complete command lines read
 
     // TLS/SSL specific
 
@@ -202,6 +242,7 @@ private:
     QString m_userName;                 // Login user name
     QString m_password;                 // User password
     QString m_currentWorkingDirectory;  // Current working directory
+    QByteArray m_currentWorkingDirectoryUtf8; // Current working directory (UTF-8 for replies)
     bool m_connected=false;             // == true then control channel connected
     bool m_passive=false;               // == true then passive data connection
     bool m_authorized=false;            // == true then user has been authorised
@@ -219,25 +260,33 @@ private:
     qint64 m_restoreFilePostion=0;      // File restore position in bytes
     QString m_renameFromFileName;       // RNFR/RNTO file name
     QChar m_dataChanelProtection='C';   // Data channel protecion level
+    quint32 m_mlstFacts=kCWFactAll;     // MLST/MLSD facts selected (OPTS MLST)
 
     qint64 m_serverWriteBytesSize=0;    // Number of bytes per write
-    QByteArray m_serverPrivateKey;      // Server private key
-    QByteArray m_serverCert;            // Server Certificate
+    qint64 m_serverWriteWindowSize=0;   // Max bytes queued on data channel
+    QSslConfiguration m_serverSslConfiguration; // Shared server TLS configuration
     bool m_serverEnabled=false;         // == true Server enabled
     QString m_serverGlobalIP;           // Server IP Address outside of NAT
     quint64 m_serverPassivePortLow=0;   // Passive port low range
     quint64 m_serverPassivePortHigh=0;  // Passive port High range
+    bool m_serverSendFileEnabled=false; // == true use sendfile() for plain downloads
+    int m_serverDataChannelTimeout=0;   // Data channel connect timeout seconds
 
     QThread *m_connectionThread=nullptr;            // Connection thread
     QSslSocket *m_controlChannelSocket=nullptr;     // Control channel socket
     CogWheelDataChannel *m_dataChannel=nullptr;     // Data channel
-    QString m_readBuffer;                           // Control channel read buffer
+    QByteArray m_readBuffer;                        // Control channel read buffer
+    int m_readPosition=0;                           // Start of first unprocessed (or held) line in buffer
+    bool m_discardingLine=false;                    // == true discarding rest of over long line
+    bool m_readBufferReset=false;                   // == true read buffer emptied by command (AUTH TLS)
+    QString m_commandArguments;                     // Current command arguments (reused)
+    CogWheelReplyBuilder m_replyBuffer;             // Reply buffer (reused)
     qintptr m_socketHandle;                         // Control channel socket handle
+    mutable QMutex m_connectionListNameMutex;       // Connection list name lock
+    QString m_connectionListName;                   // Connection list name (user once authorised)
+    QAtomicInteger<bool> m_dataChannelActive {false}; // == true data channel exists
     bool m_sslConnection=false;                     // == true connection is SSL
 
-    static QMutex m_passiveMapMutex;          // Passive port map access mutex
-    static QSet<quint64> passivePortMap;      // Currently active passive ports
-
 };
 
 #endif // COGWHEELCONTROLCHANNEL_H
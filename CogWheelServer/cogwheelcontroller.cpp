@@ -83,6 +83,7 @@ CogWheelController::CogWheelController(QCoreApplication *cogWheelApp, QObject *p
     // Controller response signal/slots
 
     connect(m_server->connections(), &CogWheelConnections::updateConnectionList, this, &CogWheelController::updateConnectionList);
+    connect(m_server->connections(), &CogWheelConnections::updateStatistics, this, &CogWheelController::updateStatistics);
 
     // Logging flush timer
 
@@ -425,6 +426,23 @@ void CogWheelController::updateConnectionList(const QStringList &connectionList)
 
 }
 
+/**
+ * @brief CogWheelController::updateStatistics
+ *
+ * Send server statistics to manager if they have changed.
+ *
+ * @param statistics
+ */
+void CogWheelController::updateStatistics(const QStringList &statistics)
+{
+
+    if (m_lastStatistics != statistics) {
+        writeCommandToManager(kCWCommandSTATISTICS, statistics);
+        m_lastStatistics = statistics;
+    }
+
+}
+
 /**
  * @brief CogWheelController::flushLoggingBufferToManager
  *
@@ -465,6 +483,7 @@ void CogWheelController::startServer(QDataStream &controllerInputStream)
             throw CogWheelController::Exception("Unable to allocate server object");
         }
         connect(m_server->connections(), &CogWheelConnections::updateConnectionList, this, &CogWheelController::updateConnectionList);
+        connect(m_server->connections(), &CogWheelConnections::updateStatistics, this, &CogWheelController::updateStatistics);
     } else {
         cogWheelWarning("CogWheel Server already started.");
     }
@@ -119,6 +119,7 @@ public slots:
     // Command slots
 
     void updateConnectionList(const QStringList &connections);
+    void updateStatistics(const QStringList &statistics);
     void flushLoggingBufferToManager();
 
 private:
@@ -127,6 +128,7 @@ private:
     QLocalSocket *m_controllerSocket=nullptr;   // Controller local socket
     quint32 m_commandBlockSize=0;               // Current command block size.
     QStringList m_lastConnectionList;           // Last connection list sent
+    QStringList m_lastStatistics;               // Last server statistics sent
     QTimer *m_logFlushTimer=nullptr;            // Log buffer flush timer
     QByteArray m_writeRawDataBuffer;            // Write raw data buffer
     QBuffer m_writeQBuffer;                     // Write QBuffer
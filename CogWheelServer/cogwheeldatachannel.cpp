@@ -27,6 +27,18 @@
 #include "cogwheelftpserverreply.h"
 #include "cogwheellogger.h"
 
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+#include <QtNetwork/private/qsslsocket_p.h>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <sys/sendfile.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
 // ====================
 // CLASS IMPLEMENTATION
 // ====================
@@ -54,10 +66,18 @@ CogWheelDataChannel::CogWheelDataChannel(qintptr controlSocketHandle, QObject *p
     connect(m_dataChannelSocket, &QSslSocket::connected, this, &CogWheelDataChannel::connected, Qt::DirectConnection);
     connect(m_dataChannelSocket, &QSslSocket::disconnected, this, &CogWheelDataChannel::disconnected, Qt::DirectConnection);
     connect(m_dataChannelSocket, &QSslSocket::bytesWritten, this, &CogWheelDataChannel::bytesWritten, Qt::DirectConnection);
+    connect(m_dataChannelSocket, &QSslSocket::encryptedBytesWritten, this, &CogWheelDataChannel::encryptedBytesWritten, Qt::DirectConnection);
     connect(m_dataChannelSocket, &QSslSocket::readyRead, this, &CogWheelDataChannel::readyRead, Qt::DirectConnection);
     connect(m_dataChannelSocket, static_cast<void (QSslSocket::*)(QAbstractSocket::SocketError)>(&QAbstractSocket::error),
             this, &CogWheelDataChannel::socketError, Qt::DirectConnection);
 
+    // Connect/accept/handshake timeout
+
+    m_connectTimer = new QTimer(this);
+    m_connectTimer->setSingleShot(true);
+
+    connect(m_connectTimer, &QTimer::timeout, this, &CogWheelDataChannel::connectTimeout);
+
 }
 
 /**
@@ -68,6 +88,7 @@ CogWheelDataChannel::CogWheelDataChannel(qintptr controlSocketHandle, QObject *p
  */
 CogWheelDataChannel::~CogWheelDataChannel()
 {
+    kernelTLSCleanup();
     fileTransferCleanup();
     dataChannelSocketCleanup();
 }
@@ -75,60 +96,86 @@ CogWheelDataChannel::~CogWheelDataChannel()
 /**
  * @brief CogWheelDataChannel::connectToClient
  *
- * Connect up data channel; either from server (active)
- * or from client (passive).
+ * Start connecting up data channel; either from server (active)
+ * or from client (passive). This does not block; the connect/accept
+ * and any TLS handshake complete in the connections event loop and
+ * any transfer requested in the meantime is queued until the channel
+ * is ready. If this does not happen before the timeout then connectFailed()
+ * is signalled.
  *
  * @param connection    Pointer to control channel instance.
+ * @param isDownload    == true channel is for a file download (RETR).
  *
- * @return  == true on sucessful connection
+ * @return  == true connection started
  */
-bool CogWheelDataChannel::connectToClient(CogWheelControlChannel *connection)
+bool CogWheelDataChannel::connectToClient(CogWheelControlChannel *connection, bool isDownload)
 {
 
-    if (m_connected) {
+    if (m_connected || isConnecting()) {
         cogWheelError(m_controlSocketHandle,"Data channel already connected.");
-        return(m_connected);
+        return(true);
     }
 
     connection->sendReplyCode(150);
 
+    // Data channel protection set to private so switch on SSL once connected
+
+    if (connection->dataChanelProtection()=='P') {
+        enbleDataChannelTLSSupport(connection);
+    }
+
+    // Encrypted download can be handed to kernel TLS once connected
+
+    m_kernelTLSDownload = isDownload && m_encryptionRequired &&
+            connection->serverSendFileEnabled() && CogWheelKernelTLS::isEnabled();
+
+    // Set write size and window
+
+    m_writeBytesSize = connection->serverWriteBytesSize();
+    m_writeWindowSize = qMax(connection->serverWriteWindowSize(), m_writeBytesSize);
+
+    // Time limit for connect/accept and handshake (0 == no limit)
+
+    if (connection->serverDataChannelTimeout() > 0) {
+        m_connectTimer->start(connection->serverDataChannelTimeout()*1000);
+    }
+
     if (!connection->isPassive()) {
 
         cogWheelInfo(m_controlSocketHandle,"Active Mode. Connecting data channel to client ....");
 
+        m_state = Connecting;
         m_dataChannelSocket->connectToHost(m_clientHostIP, m_clientHostPort);
-        m_dataChannelSocket->waitForConnected(-1);
 
-    } else {
+    } else if (m_state == Accepted) {
 
-        cogWheelInfo(m_controlSocketHandle,"Passive Mode. Waiting to connect to data channel ....");
+        // Client connected before transfer command
 
-        if (m_dataChannelSocket->state() != QAbstractSocket::ConnectedState) {
-            waitForNewConnection(-1);
+        if (m_acceptedSocketHandle != -1) {
+            qintptr handle = m_acceptedSocketHandle;
+            m_acceptedSocketHandle = -1;
+            m_state = Connecting;
+            acceptSocket(handle);
+            return(true);
         }
 
-    }
-
+        if (m_dataChannelSocket->state() != QAbstractSocket::ConnectedState) {
+            m_connectTimer->stop();
+            throw CogWheelFtpServerReply(425, "Data channel did not connect. Socket Error: "+m_dataChannelSocket->errorString());
+        }
 
-    // Data channel protection set to private so switch on SSL
+        m_state = Connecting;
+        channelConnected();
 
-    if (connection->dataChanelProtection()=='P') {
-        enbleDataChannelTLSSupport(connection);
-    }
-
-    // Set write size
+    } else {
 
-    m_writeBytesSize = connection->serverWriteBytesSize();
+        cogWheelInfo(m_controlSocketHandle,"Passive Mode. Waiting to connect to data channel ....");
 
-    // Re-check connected status and return error if not
+        m_state = Connecting;
 
-    if (m_dataChannelSocket->state() != QAbstractSocket::ConnectedState) {
-        throw CogWheelFtpServerReply(425, "Data channel did not connect. Socket Error: "+m_dataChannelSocket->errorString());
     }
 
-    m_connected=true;
-
-    return(m_connected);
+    return(true);
 
 }
 
@@ -142,12 +189,21 @@ bool CogWheelDataChannel::connectToClient(CogWheelControlChannel *connection)
 void CogWheelDataChannel::disconnectFromClient(CogWheelControlChannel *connection)
 {
 
+    m_connectTimer->stop();
+
+    kernelTLSCleanup();
+
     if (m_dataChannelSocket) {
+
+        // Channel is being closed down so no more socket notifications
+
+        m_dataChannelSocket->disconnect(this);
+
         if (m_dataChannelSocket->state() == QAbstractSocket::ConnectedState) {
             m_dataChannelSocket->flush();   // Flush any buffered data
             m_dataChannelSocket->disconnectFromHost();
             if (m_dataChannelSocket->state() != QAbstractSocket::UnconnectedState) {
-                m_dataChannelSocket->waitForDisconnected(-1);
+                m_dataChannelSocket->abort();   // Don't wait for a slow/hung client
             }
             if (m_connected) {
                 connection->sendReplyCode(226); // Data channel closed
@@ -156,6 +212,7 @@ void CogWheelDataChannel::disconnectFromClient(CogWheelControlChannel *connectio
         m_dataChannelSocket->close();
     }
     m_connected=false;
+    m_state=Idle;
 
 }
 
@@ -205,8 +262,9 @@ void CogWheelDataChannel::listenForConnection(const QString &serverIP)
         } else {
             throw Exception("Possible data channel conflict on port: "+QString::number(m_clientHostPort));
         }
-        emit passiveConnection();
         m_listening=true;
+        m_state=Listening;
+        emit passiveConnection();
     }catch(std::exception &err) {
         throw CogWheelFtpServerReply(425, err.what());
     }catch(...) {
@@ -250,14 +308,30 @@ void CogWheelDataChannel::downloadFile(CogWheelControlChannel *connection, const
         }
 
         m_downloadFileSize = m_fileBeingTransferred->size()-connection->restoreFilePostion();
+        m_downloadFileOffset = connection->restoreFilePostion();
+
+        // Plain data channel so let the kernel copy the file straight to the socket
+
+        m_downloadSendFileEnabled = m_downloadFileSize && connection->serverSendFileEnabled() &&
+                (connection->dataChanelProtection()=='C');
+
+        // Otherwise read file blocks ahead on the shared pool; the window is filled as they arrive.
+
+        if (!m_downloadSendFileEnabled && !m_kernelTLSDownload && m_downloadFileSize && CogWheelFileReadAhead::isEnabled()) {
+            m_readAhead = new CogWheelFileReadAhead(fileName, m_downloadFileOffset, m_writeBytesSize);
+            connect(m_readAhead, &CogWheelFileReadAhead::blockReady, this, &CogWheelDataChannel::fillWriteWindow);
+            if (!m_readAhead->start()) {
+                fileTransferCleanup();
+                throw CogWheelFtpServerReply(451, "Error: File "+fileName+" could not be read.");
+            }
+        }
 
-        // Send initial block of file
+        // Start sending now or when channel becomes ready
 
-        if (m_fileBeingTransferred->size()) {
-            QByteArray buffer = m_fileBeingTransferred->read(m_writeBytesSize);
-            m_dataChannelSocket->write(buffer);
+        if (m_state == Connected) {
+            startDownload();
         } else {
-            bytesWritten(0);   // File is zero length (close connection/signal success)
+            m_downloadPending = true;
         }
 
     } catch(std::exception &err) {
@@ -270,6 +344,34 @@ void CogWheelDataChannel::downloadFile(CogWheelControlChannel *connection, const
 
 }
 
+/**
+ * @brief CogWheelDataChannel::startDownload
+ *
+ * Start sending file being downloaded once the channel is ready.
+ *
+ */
+void CogWheelDataChannel::startDownload()
+{
+
+    if (m_kernelTLS) {
+        m_kernelTLS->sendFile(m_fileBeingTransferred->handle(), m_downloadFileOffset, m_downloadFileSize);
+        return;
+    }
+
+    if (m_downloadSendFileEnabled && startSendFileDownload(m_downloadFileOffset)) {
+        return;
+    }
+
+    // Queue initial blocks of file
+
+    if (m_downloadFileSize) {
+        fillWriteWindow();
+    } else {
+        m_dataChannelSocket->disconnectFromHost();   // Nothing to send (close connection/signal success)
+    }
+
+}
+
 /**
  * @brief CogWheelDataChannel::uploadFile
  *
@@ -305,39 +407,101 @@ void CogWheelDataChannel::uploadFile(CogWheelControlChannel *connection, const Q
 
 }
 
+/**
+ * @brief CogWheelDataChannel::sendData
+ *
+ * Send data over data channel; if the channel is not ready yet
+ * then keep it until it is.
+ *
+ * @param dataToSend    Data to send (bytes).
+ */
+void CogWheelDataChannel::sendData(const QByteArray &dataToSend)
+{
+
+    if (m_state == Connected) {
+        m_dataChannelSocket->write(dataToSend);
+    } else {
+        m_pendingData.append(dataToSend);
+    }
+
+}
+
+/**
+ * @brief CogWheelDataChannel::sendListing
+ *
+ * Send a directory listing over the data channel a chunk at a time as
+ * the socket drains and then close it. Takes ownership of listing.
+ *
+ * @param listing   Directory listing producer.
+ */
+void CogWheelDataChannel::sendListing(CogWheelDirectoryListing *listing)
+{
+
+    delete m_listing;
+    m_listing = listing;
+
+    if (m_state == Connected) {
+        fillListingWindow();
+    }
+
+}
+
+/**
+ * @brief CogWheelDataChannel::finishTransfer
+ *
+ * Close channel once all data sent has been written. When the
+ * socket disconnects transferFinished() is signalled.
+ *
+ */
+void CogWheelDataChannel::finishTransfer()
+{
+
+    m_finishPending = true;
+
+    if (m_state == Connected) {
+        m_dataChannelSocket->disconnectFromHost();
+    }
+
+}
+
 /**
  * @brief CogWheelDataChannel::enbleDataChannelTLSSupport
  *
- * Enable SSL on data channel.
+ * Setup SSL on data channel. The TLS handshake is started
+ * once the channel has connected.
  *
  */
 void CogWheelDataChannel::enbleDataChannelTLSSupport(CogWheelControlChannel *connection)
 {
 
-    // Use ony secure protocols
+    // Use shared secure protocols/private key/cert configuration
 
-    m_dataChannelSocket->setProtocol(QSsl::SecureProtocols);
+    m_dataChannelSocket->setSslConfiguration(connection->serverSslConfiguration());
 
-    // Create private key and cert
+    // Share the control channel's SSL context so that its server session
+    // cache and ticket keys are used and the client can resume the control
+    // channel session (no full handshake per transfer). If the control channel
+    // context has not been created a new one is used as before. This is Qt 5
+    // private API (network-private) so later versions just do a full handshake.
 
-    QSslKey sslPrivateKey(connection->serverPrivateKey(), QSsl::Rsa, QSsl::Pem, QSsl::PrivateKey);
-    QSslCertificate sslCert(connection->serverCert());
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+    QSharedPointer<QSslContext> sslContext { QSslSocketPrivate::sslContext(connection->controlChannelSocket()) };
 
-    m_dataChannelSocket->addCaCertificate(sslCert);
-    m_dataChannelSocket->setLocalCertificate(sslCert);
-    m_dataChannelSocket->setPrivateKey(sslPrivateKey);
+    if (!sslContext.isNull()) {
+        QSslSocketPrivate::checkSettingSslContext(m_dataChannelSocket, sslContext);
+    }
+#endif
 
     // Hookup error and channel encypted signals
 
     connect(m_dataChannelSocket, static_cast<void(QSslSocket::*)(const QList<QSslError> &)>(&QSslSocket::sslErrors), this, &CogWheelDataChannel::sslError);
     connect(m_dataChannelSocket, &QSslSocket::encrypted,this, &CogWheelDataChannel::dataChannelEncrypted);
 
-    // Set keep alive and start TLS negotation
+    // Set keep alive; TLS negotiation starts when connected
 
     m_dataChannelSocket->setSocketOption(QAbstractSocket::KeepAliveOption, true );
 
-    m_dataChannelSocket->startServerEncryption();
-    m_dataChannelSocket->waitForEncrypted(-1);
+    m_encryptionRequired=true;
 
 }
 
@@ -373,6 +537,10 @@ void CogWheelDataChannel::dataChannelEncrypted()
 
     m_sslConnection=true;
 
+    if (m_state == Encrypting) {
+        channelReady();
+    }
+
 }
 
 /**
@@ -388,12 +556,59 @@ void CogWheelDataChannel::incomingConnection(qintptr handle)
 
     cogWheelInfo(m_controlSocketHandle,"--- Incoming connection for data channel --- "+QString::number(handle));
 
+    // Only one connection per data channel so stop listening
+
+    close();
+
+    // Transfer command already waiting on connection ?
+
+    if (m_state == Connecting) {
+        acceptSocket(handle);
+        return;
+    }
+
+    m_state = Accepted;
+
+    // Kernel TLS may take the socket so leave it unbound until transfer command
+
+    if (CogWheelKernelTLS::isEnabled()) {
+        m_acceptedSocketHandle = handle;
+        return;
+    }
+
     if(!m_dataChannelSocket->setSocketDescriptor(handle)){
-        throw CogWheelFtpServerReply(425, "Error binding socket: "+m_dataChannelSocket->errorString());
-    } else {
-        cogWheelInfo(m_controlSocketHandle,"Data channel socket connected for handle : "+QString::number(handle));
+        cogWheelError(m_controlSocketHandle,"Error binding socket: "+m_dataChannelSocket->errorString());
+        return;
     }
 
+    cogWheelInfo(m_controlSocketHandle,"Data channel socket connected for handle : "+QString::number(handle));
+
+}
+
+/**
+ * @brief CogWheelDataChannel::acceptSocket
+ *
+ * Passive socket accepted and transfer command waiting; hand it to kernel
+ * TLS for an encrypted download otherwise bind it to the channel socket.
+ *
+ * @param handle    Handle to socket.
+ */
+void CogWheelDataChannel::acceptSocket(qintptr handle)
+{
+
+    if (m_kernelTLSDownload && startKernelTLS(handle)) {
+        return;
+    }
+
+    if(!m_dataChannelSocket->setSocketDescriptor(handle)){
+        connectFailure("Error binding socket: "+m_dataChannelSocket->errorString());
+        return;
+    }
+
+    cogWheelInfo(m_controlSocketHandle,"Data channel socket connected for handle : "+QString::number(handle));
+
+    channelConnected();
+
 }
 
 /**
@@ -405,6 +620,118 @@ void CogWheelDataChannel::incomingConnection(qintptr handle)
 void CogWheelDataChannel::connected()
 {
     cogWheelInfo(m_controlSocketHandle,"Data channel connected.");
+
+    if (m_state == Connecting) {
+        channelConnected();
+    }
+}
+
+/**
+ * @brief CogWheelDataChannel::channelConnected
+ *
+ * Data channel connected/accepted; start any TLS handshake
+ * otherwise channel is ready.
+ *
+ */
+void CogWheelDataChannel::channelConnected()
+{
+
+    if (m_encryptionRequired) {
+
+        // Active connection so take socket from QSslSocket for kernel TLS
+
+#ifdef Q_OS_LINUX
+        if (m_kernelTLSDownload && !m_dataChannelSocket->bytesAvailable()) {
+            int handle = ::fcntl(m_dataChannelSocket->socketDescriptor(), F_DUPFD_CLOEXEC, 0);
+            if ((handle != -1) && startKernelTLS(handle)) {
+                m_dataChannelSocket->disconnect(this);
+                m_dataChannelSocket->abort();
+                return;
+            }
+            if (handle != -1) {
+                ::close(handle);
+            }
+        }
+#endif
+
+        m_state = Encrypting;
+        m_dataChannelSocket->startServerEncryption();
+
+    } else {
+        channelReady();
+    }
+
+}
+
+/**
+ * @brief CogWheelDataChannel::channelReady
+ *
+ * Data channel ready for transfer. Stop timeout, send any data
+ * queued while connecting and start any pending download or close.
+ *
+ */
+void CogWheelDataChannel::channelReady()
+{
+
+    m_connectTimer->stop();
+
+    m_state = Connected;
+    m_connected = true;
+
+    cogWheelInfo(m_controlSocketHandle,"Data channel ready.");
+
+    if (!m_pendingData.isEmpty()) {
+        m_dataChannelSocket->write(m_pendingData);
+        m_pendingData.clear();
+    }
+
+    if (m_listing) {
+        fillListingWindow();
+    } else if (m_downloadPending) {
+        m_downloadPending = false;
+        startDownload();
+    } else if (m_finishPending) {
+        m_dataChannelSocket->disconnectFromHost();
+    }
+
+}
+
+/**
+ * @brief CogWheelDataChannel::connectFailure
+ *
+ * Connect/accept or TLS handshake failed. If a transfer is waiting
+ * on the channel then signal connectFailed() so that the control
+ * channel can reply and tear it down.
+ *
+ * @param message   Failure message.
+ */
+void CogWheelDataChannel::connectFailure(const QString &message)
+{
+
+    m_connectTimer->stop();
+
+    cogWheelError(m_controlSocketHandle, message);
+
+    if (isConnecting()) {
+        m_state = Idle;
+        emit connectFailed(message);
+    }
+
+}
+
+/**
+ * @brief CogWheelDataChannel::connectTimeout
+ *
+ * Data channel connect timer slot function.
+ *
+ */
+void CogWheelDataChannel::connectTimeout()
+{
+
+    if (isConnecting()) {
+        connectFailure("Data channel connection timed out.");
+    }
+
 }
 
 /**
@@ -420,7 +747,8 @@ void CogWheelDataChannel::disconnected()
 
     cogWheelInfo(m_controlSocketHandle,"Data channel disconnected.");
 
-    if (m_fileBeingTransferred) {
+    if (m_fileBeingTransferred || m_listing || m_finishPending) {
+        m_finishPending = false;
         fileTransferCleanup();
         emit transferFinished();
     }
@@ -432,34 +760,388 @@ void CogWheelDataChannel::disconnected()
  *
  * Data channel socket bytes written slot function. If a file
  * is being downloaded subtract bytes from file size and
- * when reaches zero disconnect.
+ * when reaches zero disconnect otherwise top up the write window.
  *
- * @param numBytes  Number of bytes written (unused).
+ * @param numBytes  Number of bytes written.
  */
 void CogWheelDataChannel::bytesWritten(qint64 numBytes)
 {
 
-    if (m_fileBeingTransferred) {
+    if (m_listing) {
+        fillListingWindow();
+        return;
+    }
+
+    if (m_fileBeingTransferred && m_downloadFileSize) {
         m_downloadFileSize -= numBytes;
         if (m_downloadFileSize==0) {
             m_dataChannelSocket->disconnectFromHost();
             return;
         }
-        if (!m_fileBeingTransferred->atEnd()) {
-            QByteArray buffer = m_fileBeingTransferred->read(m_writeBytesSize);
-            m_dataChannelSocket->write(buffer);
+        fillWriteWindow();
+    }
+}
+
+/**
+ * @brief CogWheelDataChannel::encryptedBytesWritten
+ *
+ * Data channel socket encrypted bytes written slot function. For a TLS
+ * download bytesWritten() is signalled once data is encrypted so the window
+ * is also topped up here as the encrypted data drains to the network.
+ *
+ * @param numBytes  Number of encrypted bytes written (unused).
+ */
+void CogWheelDataChannel::encryptedBytesWritten(qint64 numBytes)
+{
+
+    Q_UNUSED(numBytes);
+
+    if (m_listing) {
+        fillListingWindow();
+    } else if (m_fileBeingTransferred && m_downloadFileSize) {
+        fillWriteWindow();
+    }
+
+}
+
+/**
+ * @brief CogWheelDataChannel::fillWriteWindow
+ *
+ * Queue file blocks on the data channel socket until the number of bytes
+ * waiting to be sent (plain and encrypted) reaches the write window size.
+ * This keeps the socket send buffer full on high latency links. Blocks are
+ * taken from any read ahead or else read directly from the file.
+ *
+ */
+void CogWheelDataChannel::fillWriteWindow()
+{
+
+    QByteArray buffer;
+
+    if (!m_fileBeingTransferred || (m_state != Connected)) {
+        return;
+    }
+
+    while ((m_dataChannelSocket->bytesToWrite()+m_dataChannelSocket->encryptedBytesToWrite()) < m_writeWindowSize) {
+        if (m_readAhead) {
+            if (!m_readAhead->nextBlock(buffer)) {
+                break;
+            }
+        } else {
+            if (m_fileBeingTransferred->atEnd()) {
+                break;
+            }
+            buffer = m_fileBeingTransferred->read(m_writeBytesSize);
+            if (buffer.isEmpty()) {
+                break;
+            }
+        }
+        m_dataChannelSocket->write(buffer);
+    }
+
+    // Read ahead has failed or run out before whole file sent so abort and report it
+
+    if (m_readAhead && m_readAhead->isFinished() && m_downloadFileSize &&
+            !(m_dataChannelSocket->bytesToWrite()+m_dataChannelSocket->encryptedBytesToWrite())) {
+        transferFailure(451, "Download file read failure.");
+    }
+
+}
+
+/**
+ * @brief CogWheelDataChannel::fillListingWindow
+ *
+ * Queue directory listing chunks on the data channel socket until the number
+ * of bytes waiting to be sent reaches the write window size. Once the whole
+ * listing has been queued close the channel (after it has been written); if
+ * the listing could not be completed fail the transfer instead.
+ *
+ */
+void CogWheelDataChannel::fillListingWindow()
+{
+
+    QByteArray chunk;
+
+    if (!m_listing || (m_state != Connected)) {
+        return;
+    }
+
+    while ((m_dataChannelSocket->bytesToWrite()+m_dataChannelSocket->encryptedBytesToWrite()) < m_writeWindowSize) {
+        if (!m_listing->nextChunk(chunk, m_writeBytesSize)) {
+            bool listingFailed = m_listing->isFailed();
+            delete m_listing;
+            m_listing=nullptr;
+            if (listingFailed) {
+                transferFailure(451, "Directory tree too large to list.");
+                return;
+            }
+            m_finishPending=true;
+            m_dataChannelSocket->disconnectFromHost();
+            return;
+        }
+        m_dataChannelSocket->write(chunk);
+    }
+
+}
+
+/**
+ * @brief CogWheelDataChannel::startSendFileDownload
+ *
+ * Start a zero copy download of the currently open file using sendfile().
+ * A duplicate of the socket descriptor is used for the writes and for the
+ * writeable notifier so as not to clash with the sockets own notifiers. Returns
+ * false if sendfile() cannot be used in which case the caller falls back to
+ * reading/writing through user space.
+ *
+ * @param fileOffset    Offset in file to start sending from.
+ *
+ * @return  == true sendfile() download started.
+ */
+bool CogWheelDataChannel::startSendFileDownload(qint64 fileOffset)
+{
+
+#ifdef Q_OS_LINUX
+
+    // Socket still has buffered data so cannot write directly to it
+
+    if (m_dataChannelSocket->bytesToWrite()) {
+        return(false);
+    }
+
+    m_sendFileDescriptor = ::fcntl(m_dataChannelSocket->socketDescriptor(), F_DUPFD_CLOEXEC, 0);
+
+    if (m_sendFileDescriptor==-1) {
+        cogWheelWarning(m_controlSocketHandle,"Could not duplicate data channel socket for sendfile(): "+QString(std::strerror(errno)));
+        return(false);
+    }
+
+    m_sendFileOffset = fileOffset;
+    m_sendFileNotifier = new QSocketNotifier(m_sendFileDescriptor, QSocketNotifier::Write);
+
+    connect(m_sendFileNotifier, SIGNAL(activated(int)), this, SLOT(sendFileReadyToWrite()));
+
+    cogWheelInfo(m_controlSocketHandle,"Using sendfile() for download.");
+
+    return(true);
+
+#else
+
+    Q_UNUSED(fileOffset);
+
+    return(false);
+
+#endif
+
+}
+
+/**
+ * @brief CogWheelDataChannel::sendFileReadyToWrite
+ *
+ * Data channel socket writeable slot function for a sendfile() download. Keep
+ * sending file until the socket would block or the whole file has been sent; at
+ * which point disconnect.
+ *
+ */
+void CogWheelDataChannel::sendFileReadyToWrite()
+{
+
+#ifdef Q_OS_LINUX
+
+    if (!m_fileBeingTransferred || (m_sendFileDescriptor==-1)) {
+        return;
+    }
+
+    while (m_downloadFileSize) {
+
+        off_t fileOffset = m_sendFileOffset;
+        ssize_t bytesSent = ::sendfile(m_sendFileDescriptor, m_fileBeingTransferred->handle(), &fileOffset,
+                                       static_cast<size_t>(qMin(m_downloadFileSize, kCWSendFileMaxBytes)));
+
+        if (bytesSent > 0) {
+            m_sendFileOffset = fileOffset;
+            m_downloadFileSize -= bytesSent;
+            continue;
+        }
+
+        if (bytesSent==-1) {
+            if (errno==EINTR) {
+                continue;
+            }
+            if ((errno==EAGAIN) || (errno==EWOULDBLOCK)) {
+                return; // Socket full wait to be notified
+            }
+            transferFailure(426, "sendfile() failure: "+QString(std::strerror(errno)));
+        } else {
+            transferFailure(451, "File truncated during download.");
         }
+
+        return;
+
+    }
+
+    // File sent so disconnect
+
+    sendFileCleanup();
+
+    m_dataChannelSocket->disconnectFromHost();
+
+#endif
+
+}
+
+/**
+ * @brief CogWheelDataChannel::sendFileCleanup
+ *
+ * Remove any sendfile() socket notifier and duplicate socket descriptor.
+ *
+ */
+void CogWheelDataChannel::sendFileCleanup()
+{
+
+    if (m_sendFileNotifier) {
+        m_sendFileNotifier->setEnabled(false);
+        m_sendFileNotifier->deleteLater();
+        m_sendFileNotifier=nullptr;
+    }
+
+#ifdef Q_OS_LINUX
+    if (m_sendFileDescriptor!=-1) {
+        ::close(m_sendFileDescriptor);
+        m_sendFileDescriptor=-1;
+    }
+#endif
+
+}
+
+/**
+ * @brief CogWheelDataChannel::startKernelTLS
+ *
+ * Start kernel TLS handshake on a connected socket; the download is
+ * sent through it once ready. If it cannot be started the caller falls
+ * back to encrypting the channel with QSslSocket.
+ *
+ * @param handle    Connected socket (owned by kernel TLS if started).
+ *
+ * @return  == true kernel TLS handshake started.
+ */
+bool CogWheelDataChannel::startKernelTLS(qintptr handle)
+{
+
+    m_kernelTLS = new CogWheelKernelTLS(m_controlSocketHandle, this);
+
+    connect(m_kernelTLS, &CogWheelKernelTLS::handshakeComplete, this, &CogWheelDataChannel::kernelTLSEncrypted);
+    connect(m_kernelTLS, &CogWheelKernelTLS::handshakeFailed, this, &CogWheelDataChannel::kernelTLSFailed);
+    connect(m_kernelTLS, &CogWheelKernelTLS::sendComplete, this, &CogWheelDataChannel::kernelTLSSendComplete);
+
+    m_state = Encrypting;
+
+    if (!m_kernelTLS->start(handle)) {
+        cogWheelWarning(m_controlSocketHandle,"Kernel TLS could not be started so using QSslSocket.");
+        m_state = Connecting;
+        m_kernelTLSDownload = false;
+        kernelTLSCleanup();
+        return(false);
+    }
+
+    return(true);
+
+}
+
+/**
+ * @brief CogWheelDataChannel::kernelTLSEncrypted
+ *
+ * Kernel TLS handshake complete slot function.
+ *
+ */
+void CogWheelDataChannel::kernelTLSEncrypted()
+{
+
+    cogWheelInfo(m_controlSocketHandle,"Data Channel now encrypted.");
+
+    m_sslConnection=true;
+
+    if (m_state == Encrypting) {
+        channelReady();
+    }
+
+}
+
+/**
+ * @brief CogWheelDataChannel::kernelTLSFailed
+ *
+ * Kernel TLS handshake failed slot function.
+ *
+ * @param message   Failure message.
+ */
+void CogWheelDataChannel::kernelTLSFailed(const QString &message)
+{
+    connectFailure(message);
+}
+
+/**
+ * @brief CogWheelDataChannel::kernelTLSSendComplete
+ *
+ * Kernel TLS download finished slot function. Close the connection
+ * and signal transfer finished; if it failed (TLS error or file
+ * truncated) the connection is reset and the failure signalled.
+ *
+ * @param success   == true whole file sent.
+ */
+void CogWheelDataChannel::kernelTLSSendComplete(bool success)
+{
+
+    cogWheelInfo(m_controlSocketHandle,"Data channel disconnected.");
+
+    kernelTLSCleanup();
+
+    if (!success) {
+        transferFailure(426, "Kernel TLS download failed.");
+        return;
     }
+
+    fileTransferCleanup();
+
+    emit transferFinished();
+
+}
+
+/**
+ * @brief CogWheelDataChannel::kernelTLSCleanup
+ *
+ * Close down any kernel TLS connection.
+ *
+ */
+void CogWheelDataChannel::kernelTLSCleanup()
+{
+
+    if (m_kernelTLS) {
+        m_kernelTLS->disconnect(this);
+        m_kernelTLS->stop();
+        m_kernelTLS->deleteLater();
+        m_kernelTLS=nullptr;
+    }
+
 }
 
 /**
  * @brief CogWheelDataChannel::fileTransferCleanup
  *
- * File upload/download cleanup code. This includes
+ * File upload/download/listing cleanup code. This includes
  * closing any file and deleting its object instance.
  */
 void CogWheelDataChannel::fileTransferCleanup()
 {
+    sendFileCleanup();
+
+    delete m_listing;
+    m_listing=nullptr;
+
+    if (m_readAhead) {
+        m_readAhead->stop();
+        m_readAhead->deleteLater();
+        m_readAhead=nullptr;
+    }
+
     if (m_fileBeingTransferred) {
         if (m_fileBeingTransferred->isOpen()) {
             m_fileBeingTransferred->close();
@@ -470,6 +1152,33 @@ void CogWheelDataChannel::fileTransferCleanup()
     }
 }
 
+/**
+ * @brief CogWheelDataChannel::transferFailure
+ *
+ * Transfer failed part way through; abort the data connection (so the
+ * client does not see an orderly close and take the transfer as complete)
+ * and signal the failure for the control channel to reply with.
+ *
+ * @param replyCode     Reply code for the client (426/451).
+ * @param message       Failure message.
+ */
+void CogWheelDataChannel::transferFailure(quint16 replyCode, const QString &message)
+{
+
+    cogWheelError(m_controlSocketHandle, message);
+
+    m_finishPending = false;
+
+    fileTransferCleanup();
+
+    if (m_dataChannelSocket) {
+        m_dataChannelSocket->abort();
+    }
+
+    emit transferFailed(replyCode, message);
+
+}
+
 /**
  * @brief CogWheelDataChannel::dataChannelSocketCleanup
  *
@@ -480,6 +1189,13 @@ void CogWheelDataChannel::fileTransferCleanup()
 void CogWheelDataChannel::dataChannelSocketCleanup()
 {
 
+#ifdef Q_OS_LINUX
+    if (m_acceptedSocketHandle != -1) {
+        ::close(static_cast<int>(m_acceptedSocketHandle));
+        m_acceptedSocketHandle = -1;
+    }
+#endif
+
     if (m_dataChannelSocket) {
         if (m_dataChannelSocket->isOpen()) {
             m_dataChannelSocket->close();
@@ -515,6 +1231,14 @@ void CogWheelDataChannel::readyRead()
  */
 void CogWheelDataChannel::socketError(QAbstractSocket::SocketError socketError)
 {
+
+    // Connect or TLS handshake failed
+
+    if (isConnecting()) {
+        connectFailure("Data channel did not connect. Socket Error: "+m_dataChannelSocket->errorString());
+        return;
+    }
+
     if (socketError!=QAbstractSocket::RemoteHostClosedError) {
         cogWheelError(m_controlSocketHandle,"Data channel socket error: "+QString::number(socketError));
     }
@@ -522,9 +1246,6 @@ void CogWheelDataChannel::socketError(QAbstractSocket::SocketError socketError)
     if (socketError==QAbstractSocket::RemoteHostClosedError) {
         if (m_dataChannelSocket->state() == QAbstractSocket::ConnectedState) {
             m_dataChannelSocket->disconnectFromHost();
-            if (m_dataChannelSocket->state() != QAbstractSocket::UnconnectedState) {
-                m_dataChannelSocket->waitForDisconnected(-1);
-            }
         }
     }
 
@@ -580,6 +1301,15 @@ void CogWheelDataChannel::setConnected(bool connected)
     m_connected = connected;
 }
 
+/**
+ * @brief CogWheelDataChannel::isConnecting
+ * @return
+ */
+bool CogWheelDataChannel::isConnecting() const
+{
+    return((m_state == Connecting) || (m_state == Encrypting));
+}
+
 /**
  * @brief CogWheelDataChannel::isListening
  * @return
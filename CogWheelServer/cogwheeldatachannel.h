@@ -27,6 +27,9 @@
 // =============
 
 #include "cogwheel.h"
+#include "cogwheelfilereadahead.h"
+#include "cogwheelkerneltls.h"
+#include "cogwheeldirectorylisting.h"
 
 #include <QObject>
 #include <QString>
@@ -36,6 +39,8 @@
 #include <QSslCertificate>
 #include <QSslKey>
 #include <QFile>
+#include <QSocketNotifier>
+#include <QTimer>
 
 // Forward declaration for control channel
 
@@ -61,6 +66,17 @@ public:
 
     };
 
+    // Channel connection state
+
+    enum ChannelState {
+        Idle,           // Created (active mode) but not yet connecting
+        Listening,      // Listening for passive connection
+        Accepted,       // Passive connection accepted before transfer command
+        Connecting,     // Waiting for connect/accept to complete
+        Encrypting,     // Waiting for TLS handshake to complete
+        Connected       // Connected and ready to transfer
+    };
+
     // Constructor / Destructor
 
     explicit CogWheelDataChannel(qintptr controlSocketHandle, QObject *parent = nullptr);
@@ -68,7 +84,7 @@ public:
 
     // Channel control
 
-    bool connectToClient(CogWheelControlChannel *connection);
+    bool connectToClient(CogWheelControlChannel *connection, bool isDownload=false);
     void disconnectFromClient(CogWheelControlChannel *connection);
 
     // Channel action
@@ -76,6 +92,9 @@ public:
     void listenForConnection(const QString &serverIP);
     void downloadFile(CogWheelControlChannel *connection, const QString &fileName);
     void uploadFile(CogWheelControlChannel *connection, const QString &fileName);
+    void sendData(const QByteArray &dataToSend);
+    void sendListing(CogWheelDirectoryListing *listing);
+    void finishTransfer();
 
     // TLS
 
@@ -91,6 +110,7 @@ public:
     void setListening(bool isListening);
     bool isConnected() const;
     void setConnected(bool isConnected);
+    bool isConnecting() const;
     bool isFileBeingUploaded() const;
     void setFileBeingUploaded(bool isFileBeingUploaded);
     QSslSocket *dataChannelSocket() const;
@@ -104,10 +124,43 @@ private:
 
     void fileTransferCleanup();
 
+    // Abort failed transfer
+
+    void transferFailure(quint16 replyCode, const QString &message);
+
     // Cleanup data channel socket
 
     void dataChannelSocketCleanup();
 
+    // Queue file blocks on socket up to write window size
+
+    void fillWriteWindow();
+
+    // Queue listing chunks on socket up to write window size
+
+    void fillListingWindow();
+
+    // Connect/accept/handshake state transitions
+
+    void channelConnected();
+    void channelReady();
+    void connectFailure(const QString &message);
+
+    // Start queued download once channel ready
+
+    void startDownload();
+
+    // Zero copy (sendfile) download
+
+    bool startSendFileDownload(qint64 fileOffset);
+    void sendFileCleanup();
+
+    // Kernel TLS encrypted download
+
+    void acceptSocket(qintptr handle);
+    bool startKernelTLS(qintptr handle);
+    void kernelTLSCleanup();
+
 protected:
 
     // QTcpServer overrides
@@ -119,7 +172,9 @@ signals:
     // Channel notification
 
     void transferFinished();                   // File transfer finished
+    void transferFailed(quint16 replyCode, const QString &message); // File transfer failed
     void passiveConnection();                  // Passive connection
+    void connectFailed(const QString &message);// Connect/accept/handshake failed
 
 public slots:
 
@@ -128,8 +183,17 @@ public slots:
     void connected();
     void disconnected();
     void bytesWritten(qint64 numBytes);
+    void encryptedBytesWritten(qint64 numBytes);
     void readyRead();
     void socketError(QAbstractSocket::SocketError socketError);
+    void sendFileReadyToWrite();
+    void connectTimeout();
+
+    // Kernel TLS download
+
+    void kernelTLSEncrypted();
+    void kernelTLSFailed(const QString &message);
+    void kernelTLSSendComplete(bool success);
 
     // TLS/SSL specific
 
@@ -142,11 +206,28 @@ private:
     QHostAddress m_clientHostIP;          // Address of client
     quint16 m_clientHostPort;             // Port used on client
     bool m_connected=false;               // == true data channel connected
+    ChannelState m_state=Idle;            // Connect/accept/handshake state
+    QTimer *m_connectTimer=nullptr;       // Connect/accept/handshake timeout
+    bool m_encryptionRequired=false;      // == true start TLS once connected
+    QByteArray m_pendingData;             // Data sent before channel ready
+    bool m_finishPending=false;           // == true close once data written
+    bool m_downloadPending=false;         // == true start download once ready
+    bool m_downloadSendFileEnabled=false; // == true download may use sendfile()
+    qint64 m_downloadFileOffset=0;        // Download start offset in file
     bool m_listening=false;               // == true listening on data channel
     QFile *m_fileBeingTransferred=nullptr;// Upload/download file
+    CogWheelFileReadAhead *m_readAhead=nullptr; // Download file read ahead
+    CogWheelDirectoryListing *m_listing=nullptr; // Directory listing being sent
     quint64 m_downloadFileSize=0;         // Downloading file size
     qint64 m_writeBytesSize=0;            // No of bytes per write
+    qint64 m_writeWindowSize=0;           // Max bytes queued on socket
     bool m_sslConnection=false;           // == true connection is SSL
+    int m_sendFileDescriptor=-1;          // Duplicate socket descriptor used by sendfile()
+    QSocketNotifier *m_sendFileNotifier=nullptr; // Socket writeable notifier for sendfile()
+    qint64 m_sendFileOffset=0;            // Current sendfile() file offset
+    bool m_kernelTLSDownload=false;       // == true encrypted download may use kernel TLS
+    CogWheelKernelTLS *m_kernelTLS=nullptr; // Kernel TLS download
+    qintptr m_acceptedSocketHandle=-1;    // Passive socket accepted but not yet bound
 
 };
 #endif // COGWHEELDATACHANNEL_H
@@ -0,0 +1,244 @@
+/*
+ * File:   cogwheeldirectorylisting.cpp
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+//
+// Class: CogWheelDirectoryListing
+//
+// Description: Class to produce a LIST/NLST/MLSD directory listing a chunk at a
+// time. The directory is read incrementally (unsorted) by the directory scanner and each chunk of UTF-8 lines is
+// built only when the data channel has room for it, so memory used per listing
+// stays bounded whatever the size of the directory and the first lines reach
+// the client straight away. Complete listings are kept in the listing cache and
+// a repeat listing of an unchanged directory is sent from there.
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheeldirectorylisting.h"
+#include "cogwheelftpcoreutil.h"
+#include "cogwheellistingcache.h"
+#include "cogwheeldirectoryscanner.h"
+
+// Facts needed for a LIST line
+
+constexpr const quint32 kCWLISTLineFacts=kCWFactType | kCWFactSize | kCWFactModify | kCWFactUnixMode |
+                                          kCWFactUnixOwner | kCWFactUnixGroup;
+
+// ====================
+// CLASS IMPLEMENTATION
+// ====================
+
+/**
+ * @brief CogWheelDirectoryListing::CogWheelDirectoryListing
+ *
+ * Look for listing in cache otherwise start walking directory. NLST
+ * does not list . and .. entries.
+ *
+ * @param path          Local directory path.
+ * @param format        Listing line format.
+ * @param namePrefix    Prefix for NLST names (path argument).
+ * @param facts         Facts selected for MLSD.
+ */
+CogWheelDirectoryListing::CogWheelDirectoryListing(const QString &path, ListingFormat format, const QString &namePrefix,
+                                                   quint32 facts)
+    : m_format(format), m_namePrefix(namePrefix), m_facts(facts), m_path(path)
+{
+
+    CogWheelListingCache &listingCache { CogWheelListingCache::getInstance() };
+
+    if (m_format == NLST) {
+        if (!m_namePrefix.endsWith("/")) {
+            m_namePrefix.append("/");
+        }
+    }
+
+    m_encodedNamePrefix = m_namePrefix.toUtf8();
+
+    // Key on path, format, hidden files listed, MLSD facts and NLST prefix
+
+    m_cacheKey = path+'\0'+QString::number(m_format)+"H"+QString::number(m_facts, 16)+'\0'+m_namePrefix;
+
+    if (listingCache.find(m_cacheKey, m_cachedListing)) {
+        return;
+    }
+
+    m_cacheGeneration = listingCache.watch(path);
+
+    m_directory.reset(new CogWheelDirectoryScanner(path, m_format != NLST, scannerFacts(m_format, m_facts)));
+
+}
+
+/**
+ * @brief CogWheelDirectoryListing::CogWheelDirectoryListing
+ *
+ * Constructor for derived listings that walk directories themselves.
+ *
+ * @param format    Listing line format.
+ * @param facts     Facts selected for MLSD.
+ */
+CogWheelDirectoryListing::CogWheelDirectoryListing(ListingFormat format, quint32 facts)
+    : m_format(format), m_facts(facts)
+{
+
+}
+
+/**
+ * @brief CogWheelDirectoryListing::~CogWheelDirectoryListing
+ *
+ * Destructor. A listing abandoned part way through releases its directory watch.
+ *
+ */
+CogWheelDirectoryListing::~CogWheelDirectoryListing()
+{
+
+    if (m_cacheGeneration) {
+        CogWheelListingCache::getInstance().release(m_path);
+    }
+
+}
+
+/**
+ * @brief CogWheelDirectoryListing::scannerFacts
+ *
+ * @param format    Listing line format.
+ * @param facts     Facts selected for MLSD.
+ *
+ * @return  Facts the directory scanner needs to stat for a listing format.
+ */
+quint32 CogWheelDirectoryListing::scannerFacts(ListingFormat format, quint32 facts)
+{
+
+    switch (format) {
+    case LIST:
+        return(kCWLISTLineFacts);
+    case NLST:
+        return(kCWFactType);
+    case MLSD:
+        break;
+    }
+
+    return(facts);
+
+}
+
+/**
+ * @brief CogWheelDirectoryListing::appendEntry
+ *
+ * Append listing line for a directory entry to chunk.
+ *
+ * @param chunk         Listing lines (UTF-8).
+ * @param format        Listing line format.
+ * @param facts         Facts selected for MLSD.
+ * @param namePrefix    NLST name prefix (UTF-8).
+ * @param fileStat      Entry metadata.
+ */
+void CogWheelDirectoryListing::appendEntry(QByteArray &chunk, ListingFormat format, quint32 facts,
+                                           const QByteArray &namePrefix, const CogWheelFileStat &fileStat)
+{
+
+    switch (format) {
+    case LIST:
+        CogWheelFTPCoreUtil::appendLISTLine(chunk, fileStat);
+        break;
+    case NLST:
+        chunk.append(namePrefix);
+        chunk.append(fileStat.fileName);
+        break;
+    case MLSD:
+        CogWheelFTPCoreUtil::appendFileFactList(chunk, fileStat, facts);
+        break;
+    }
+
+    chunk.append(kCWEOL);
+
+}
+
+/**
+ * @brief CogWheelDirectoryListing::nextChunk
+ *
+ * Build the next chunk of listing lines; entries are added until the
+ * chunk reaches the maximum size (a single line may take it over). A
+ * cached listing is handed out in maximum size slices of the cached data
+ * (no copy). When the walk completes the listing is added to the cache if
+ * it fits.
+ *
+ * @param chunk         Returned UTF-8 listing lines.
+ * @param maxChunkSize  Maximum chunk size in bytes.
+ *
+ * @return  == false listing complete (chunk empty).
+ */
+bool CogWheelDirectoryListing::nextChunk(QByteArray &chunk, qint64 maxChunkSize)
+{
+
+    chunk.clear();
+
+    // Slice cached listing; the socket write copies the slice so the raw data
+    // only needs to live until then (it is kept in m_cachedListing).
+
+    if (!m_directory) {
+        int sliceSize = static_cast<int>(qMin(maxChunkSize, static_cast<qint64>(m_cachedListing.size()-m_cachedOffset)));
+        if (sliceSize > 0) {
+            chunk = QByteArray::fromRawData(m_cachedListing.constData()+m_cachedOffset, sliceSize);
+            m_cachedOffset += sliceSize;
+        }
+        return(!chunk.isEmpty());
+    }
+
+    CogWheelFileStat fileStat;
+
+    chunk.reserve(static_cast<int>(maxChunkSize)+kCWListingLineReserve);
+
+    while ((chunk.size() < maxChunkSize) && m_directory->next(fileStat)) {
+
+        appendEntry(chunk, m_format, m_facts, m_encodedNamePrefix, fileStat);
+    }
+
+    // Keep listing for cache unless it is too large
+
+    if (m_cacheGeneration) {
+        if (static_cast<quint64>(m_cacheBuffer.size()+chunk.size()) > CogWheelListingCache::getInstance().maxBytes()) {
+            CogWheelListingCache::getInstance().release(m_path);
+            m_cacheGeneration = 0;
+            m_cacheBuffer.clear();
+        } else if (chunk.isEmpty()) {
+            CogWheelListingCache::getInstance().insert(m_path, m_cacheKey, m_cacheBuffer, m_cacheGeneration);
+            m_cacheGeneration = 0;
+            m_cacheBuffer.clear();
+        } else {
+            m_cacheBuffer.append(chunk);
+        }
+    }
+
+    return(!chunk.isEmpty());
+
+}
+
+/**
+ * @brief CogWheelDirectoryListing::isFailed
+ *
+ * @return  == true listing could not be completed.
+ */
+bool CogWheelDirectoryListing::isFailed() const
+{
+    return(m_failed);
+}
+
+/**
+ * @brief CogWheelDirectoryListing::setFailed
+ *
+ * @param failed    == true listing could not be completed.
+ */
+void CogWheelDirectoryListing::setFailed(bool failed)
+{
+    m_failed = failed;
+}
@@ -0,0 +1,104 @@
+/*
+ * File:   cogwheeldirectorylisting.h
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+#ifndef COGWHEELDIRECTORYLISTING_H
+#define COGWHEELDIRECTORYLISTING_H
+
+//
+// Class: CogWheelDirectoryListing
+//
+// Description: Class to produce a LIST/NLST/MLSD directory listing a chunk at a
+// time. The directory is read incrementally (unsorted) by the directory scanner and each chunk of UTF-8 lines is
+// built only when the data channel has room for it, so memory used per listing
+// stays bounded whatever the size of the directory and the first lines reach
+// the client straight away. Complete listings are kept in the listing cache and
+// a repeat listing of an unchanged directory is sent from there.
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheel.h"
+
+#include <QString>
+#include <QByteArray>
+#include <QScopedPointer>
+
+class CogWheelDirectoryScanner;
+struct CogWheelFileStat;
+
+// =================
+// CLASS DECLARATION
+// =================
+
+class CogWheelDirectoryListing
+{
+
+public:
+
+    // Listing line format
+
+    enum ListingFormat {
+        LIST,       // 'ls -l' style line
+        NLST,       // Name only (prefixed by path argument)
+        MLSD        // Fact list
+    };
+
+    // Constructor / Destructor
+
+    CogWheelDirectoryListing(const QString &path, ListingFormat format, const QString &namePrefix=QString(),
+                             quint32 facts=kCWFactAll);
+    virtual ~CogWheelDirectoryListing();
+
+    // Build next chunk of listing (false == listing complete)
+
+    virtual bool nextChunk(QByteArray &chunk, qint64 maxChunkSize);
+
+    // Listing could not be completed (set when nextChunk() returns false)
+
+    bool isFailed() const;
+
+protected:
+
+    void setFailed(bool failed);
+
+    // Constructor for derived listings
+
+    CogWheelDirectoryListing(ListingFormat format, quint32 facts);
+
+    // Facts scanner needs for format
+
+    static quint32 scannerFacts(ListingFormat format, quint32 facts);
+
+    // Append listing line for entry
+
+    static void appendEntry(QByteArray &chunk, ListingFormat format, quint32 facts,
+                            const QByteArray &namePrefix, const CogWheelFileStat &fileStat);
+
+private:
+
+    QScopedPointer<CogWheelDirectoryScanner> m_directory;  // Directory being listed
+    ListingFormat m_format;                     // Listing line format
+    QString m_namePrefix;                       // NLST name prefix
+    QByteArray m_encodedNamePrefix;             // NLST name prefix (UTF-8)
+    quint32 m_facts=kCWFactAll;                 // MLSD facts selected
+    QString m_path;                             // Local directory path
+    QString m_cacheKey;                         // Listing cache key
+    quint64 m_cacheGeneration=0;                // Directory generation (0 == do not cache)
+    QByteArray m_cachedListing;                 // Listing found in cache
+    int m_cachedOffset=0;                       // Offset of next cached listing slice
+    QByteArray m_cacheBuffer;                   // Listing built so far for cache
+    bool m_failed=false;                        // == true listing could not be completed
+
+};
+
+#endif // COGWHEELDIRECTORYLISTING_H
@@ -0,0 +1,558 @@
+/*
+ * File:   cogwheeldirectoryscanner.cpp
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+//
+// Class: CogWheelDirectoryScanner
+//
+// Description: Class to read the entries of a directory (unsorted) along with just
+// the file metadata needed by the listing commands. On Linux entries are read in
+// batches with getdents64 and each is stat'ed once with statx relative to the open
+// directory; elsewhere QDirIterator/QFileInfo are used. Only directories and regular
+// files (or symbolic links to them) are returned as with the default QDir filter.
+// Entries are read a batch at a time and if a stat pool has been configured (for
+// network filesystems where each stat is a round trip) the batch is stat'ed
+// concurrently on it; entries are still returned in directory order.
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheeldirectoryscanner.h"
+
+#include <QFile>
+#include <QDateTime>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QTextCodec>
+
+#ifdef Q_OS_LINUX
+#include <sys/syscall.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <cstddef>
+#include <cstring>
+#endif
+
+// ===================
+// LOCAL DEFINITIONS
+// ===================
+
+// Maximum entries read per batch (QDirIterator)
+
+constexpr const int kCWEntryBatchSize=512;
+
+#ifdef Q_OS_LINUX
+
+// getdents64 buffer size
+
+constexpr const int kCWEntryBufferSize=1024*32;
+
+// Kernel directory entry as returned by getdents64
+
+struct LinuxDirent64 {
+    quint64 d_ino;
+    qint64 d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+/**
+ * @brief statAt
+ *
+ * Stat file relative to an open directory (following any symbolic link)
+ * fetching only the fields used by listings. Returns false if the file
+ * cannot be stat'ed or is not a directory or regular file.
+ *
+ * @param directoryDescriptor   Open directory (AT_FDCWD == current directory).
+ * @param fileName              File name.
+ * @param facts                 Facts needed (only these fields are requested).
+ * @param fileStat              Returned file metadata.
+ *
+ * @return  == true file stat'ed.
+ */
+static bool statAt(int directoryDescriptor, const char *fileName, quint32 facts, CogWheelFileStat &fileStat)
+{
+
+    quint32 fileMode;
+
+#ifdef STATX_BASIC_STATS
+
+    struct statx fileStatx;
+    unsigned int statxMask = STATX_TYPE | STATX_MODE;
+
+    if (facts & kCWFactSize) {
+        statxMask |= STATX_SIZE;
+    }
+    if (facts & kCWFactModify) {
+        statxMask |= STATX_MTIME;
+    }
+    if (facts & kCWFactCreate) {
+        statxMask |= STATX_BTIME | STATX_CTIME;
+    }
+    if (facts & (kCWFactUnixOwner | kCWFactUnixOwnerName)) {
+        statxMask |= STATX_UID;
+    }
+    if (facts & (kCWFactUnixGroup | kCWFactUnixGroupName)) {
+        statxMask |= STATX_GID;
+    }
+
+    if (::statx(directoryDescriptor, fileName, AT_NO_AUTOMOUNT, statxMask, &fileStatx)==-1) {
+        return(false);
+    }
+
+    fileMode = fileStatx.stx_mode;
+    fileStat.size = fileStatx.stx_size;
+    fileStat.modifyTime = (static_cast<qint64>(fileStatx.stx_mtime.tv_sec)*1000)+(fileStatx.stx_mtime.tv_nsec/1000000);
+    if (fileStatx.stx_mask & STATX_BTIME) {
+        fileStat.createTime = (static_cast<qint64>(fileStatx.stx_btime.tv_sec)*1000)+(fileStatx.stx_btime.tv_nsec/1000000);
+    } else {
+        fileStat.createTime = (static_cast<qint64>(fileStatx.stx_ctime.tv_sec)*1000)+(fileStatx.stx_ctime.tv_nsec/1000000);
+    }
+    fileStat.ownerId = fileStatx.stx_uid;
+    fileStat.groupId = fileStatx.stx_gid;
+
+#else
+
+    Q_UNUSED(facts);
+
+    struct stat fileStatBuffer;
+
+    if (::fstatat(directoryDescriptor, fileName, &fileStatBuffer, AT_NO_AUTOMOUNT)==-1) {
+        return(false);
+    }
+
+    fileMode = fileStatBuffer.st_mode;
+    fileStat.size = static_cast<quint64>(fileStatBuffer.st_size);
+    fileStat.modifyTime = (static_cast<qint64>(fileStatBuffer.st_mtim.tv_sec)*1000)+(fileStatBuffer.st_mtim.tv_nsec/1000000);
+    fileStat.createTime = (static_cast<qint64>(fileStatBuffer.st_ctim.tv_sec)*1000)+(fileStatBuffer.st_ctim.tv_nsec/1000000);
+    fileStat.ownerId = fileStatBuffer.st_uid;
+    fileStat.groupId = fileStatBuffer.st_gid;
+
+#endif
+
+    if (!S_ISDIR(fileMode) && !S_ISREG(fileMode)) {
+        return(false);
+    }
+
+    fileStat.isDir = S_ISDIR(fileMode);
+    fileStat.permissions = fileMode & 07777;
+
+    return(true);
+
+}
+
+/**
+ * @brief encodedNameToUtf8
+ *
+ * Convert file name from local encoding to UTF-8; when the local encoding
+ * is UTF-8 (the norm) the name is returned as is without copying.
+ *
+ * @param encodedName   File name in local encoding.
+ *
+ * @return  File name as UTF-8.
+ */
+static QByteArray encodedNameToUtf8(const QByteArray &encodedName)
+{
+
+    static const bool localIsUtf8 { QTextCodec::codecForLocale()->mibEnum()==106 };
+
+    if (localIsUtf8) {
+        return(encodedName);
+    }
+
+    return(QFile::decodeName(encodedName).toUtf8());
+
+}
+
+/**
+ * @brief isSymLinkAt
+ *
+ * @param directoryDescriptor   Open directory (AT_FDCWD == current directory).
+ * @param fileName              File name.
+ *
+ * @return  == true file is a symbolic link.
+ */
+static bool isSymLinkAt(int directoryDescriptor, const char *fileName)
+{
+
+    struct stat fileStatBuffer;
+
+    if (::fstatat(directoryDescriptor, fileName, &fileStatBuffer, AT_SYMLINK_NOFOLLOW)==-1) {
+        return(false);
+    }
+
+    return(S_ISLNK(fileStatBuffer.st_mode));
+
+}
+
+#endif
+
+//
+// Parallel stat pool task. Stats every stride'th entry of a batch starting at
+// first and then signals completion. Each entry is written by only one task
+// and the scanner waits for all tasks before touching the batch.
+//
+
+class CogWheelStatTask : public QRunnable
+{
+
+public:
+
+    CogWheelStatTask(const CogWheelDirectoryScanner *scanner, CogWheelDirectoryScanner::BatchEntry *entries,
+                     int entryCount, int first, int stride, QSemaphore *tasksDone)
+        : m_scanner(scanner), m_entries(entries), m_entryCount(entryCount),
+          m_first(first), m_stride(stride), m_tasksDone(tasksDone) { }
+
+    void run() override
+    {
+        m_scanner->statEntries(m_entries, m_entryCount, m_first, m_stride);
+        m_tasksDone->release();
+    }
+
+private:
+    const CogWheelDirectoryScanner *m_scanner;          // Scanner owning batch
+    CogWheelDirectoryScanner::BatchEntry *m_entries;    // Batch entries
+    int m_entryCount;                                   // Entries in batch
+    int m_first;                                        // First entry to stat
+    int m_stride;                                       // Entries between stats
+    QSemaphore *m_tasksDone;                            // Released when done
+
+};
+
+// ====================
+// CLASS IMPLEMENTATION
+// ====================
+
+// Shared parallel stat thread pool and its size
+
+QThreadPool CogWheelDirectoryScanner::m_statPool;
+int CogWheelDirectoryScanner::m_statThreadCount=0;
+
+/**
+ * @brief CogWheelDirectoryScanner::CogWheelDirectoryScanner
+ *
+ * Open directory for scanning.
+ *
+ * @param path                  Local directory path.
+ * @param includeDotEntries     == true return . and .. entries.
+ * @param facts                 Facts needed from each entry's stat.
+ */
+CogWheelDirectoryScanner::CogWheelDirectoryScanner(const QString &path, bool includeDotEntries, quint32 facts)
+    : m_includeDotEntries(includeDotEntries), m_facts(facts), m_path(path)
+{
+
+#ifdef Q_OS_LINUX
+
+    m_directoryDescriptor = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (m_directoryDescriptor!=-1) {
+        m_entryBuffer.resize(kCWEntryBufferSize);
+    }
+
+#else
+
+    QDir::Filters filters { QDir::AllEntries | QDir::Hidden };
+
+    if (!m_includeDotEntries) {
+        filters |= QDir::NoDotAndDotDot;
+    }
+
+    m_directory.reset(new QDirIterator(path, filters));
+
+#endif
+
+}
+
+/**
+ * @brief CogWheelDirectoryScanner::~CogWheelDirectoryScanner
+ *
+ * Destructor. Close directory.
+ *
+ */
+CogWheelDirectoryScanner::~CogWheelDirectoryScanner()
+{
+
+#ifdef Q_OS_LINUX
+    if (m_directoryDescriptor!=-1) {
+        ::close(m_directoryDescriptor);
+    }
+#endif
+
+}
+
+/**
+ * @brief CogWheelDirectoryScanner::setStatThreadCount
+ *
+ * Set the number of threads in the shared parallel stat pool. A count
+ * of zero (or one) stats entries sequentially on the calling thread.
+ *
+ * @param threadCount   Number of pool threads.
+ */
+void CogWheelDirectoryScanner::setStatThreadCount(int threadCount)
+{
+    m_statThreadCount = threadCount;
+    if (m_statThreadCount > 1) {
+        m_statPool.setMaxThreadCount(m_statThreadCount);
+    }
+}
+
+/**
+ * @brief CogWheelDirectoryScanner::next
+ *
+ * Return next directory entry and its metadata. Entries that cannot
+ * be stat'ed (removed since read, broken links) are skipped.
+ *
+ * @param fileStat  Returned entry metadata.
+ *
+ * @return  == false no more entries.
+ */
+bool CogWheelDirectoryScanner::next(CogWheelFileStat &fileStat)
+{
+
+    for (;;) {
+
+        while (m_batchPosition < m_batch.size()) {
+            BatchEntry &entry = m_batch[m_batchPosition++];
+            if (entry.valid) {
+                fileStat = entry.fileStat;
+                return(true);
+            }
+        }
+
+        if (!readBatch()) {
+            return(false);
+        }
+
+        statBatch();
+
+    }
+
+}
+
+/**
+ * @brief CogWheelDirectoryScanner::readBatch
+ *
+ * Read the names of the next batch of directory entries (one getdents64
+ * buffer on Linux).
+ *
+ * @return  == false no more entries.
+ */
+bool CogWheelDirectoryScanner::readBatch()
+{
+
+    m_batch.clear();
+    m_batchPosition = 0;
+
+#ifdef Q_OS_LINUX
+
+    if (m_directoryDescriptor==-1) {
+        return(false);
+    }
+
+    long bytesRead = ::syscall(SYS_getdents64, m_directoryDescriptor, m_entryBuffer.data(), m_entryBuffer.size());
+
+    if (bytesRead <= 0) {
+        return(false);
+    }
+
+    for (long entryPosition=0; entryPosition < bytesRead; ) {
+
+        const LinuxDirent64 *entry = reinterpret_cast<const LinuxDirent64 *>(m_entryBuffer.constData()+entryPosition);
+        const char *entryName = reinterpret_cast<const char *>(entry)+offsetof(LinuxDirent64, d_name);
+
+        entryPosition += entry->d_reclen;
+
+        if ((entryName[0]=='.') && ((entryName[1]==0) || ((entryName[1]=='.') && (entryName[2]==0)))) {
+            if (!m_includeDotEntries) {
+                continue;
+            }
+        }
+
+        BatchEntry batchEntry;
+        batchEntry.name = entryName;
+        batchEntry.isSymLink = (entry->d_type==DT_LNK);
+        batchEntry.typeUnknown = (entry->d_type==DT_UNKNOWN);
+        m_batch.append(batchEntry);
+
+    }
+
+    return(true);
+
+#else
+
+    while ((m_batch.size() < kCWEntryBatchSize) && m_directory->hasNext()) {
+        m_directory->next();
+        BatchEntry batchEntry;
+        batchEntry.name = QFile::encodeName(m_directory->fileName());
+        batchEntry.typeUnknown = true;
+        m_batch.append(batchEntry);
+    }
+
+    return(!m_batch.isEmpty());
+
+#endif
+
+}
+
+/**
+ * @brief CogWheelDirectoryScanner::statBatch
+ *
+ * Stat all entries of the current batch. With a stat pool the batch is
+ * split between up to pool size tasks (the calling thread taking one
+ * share) and waited on; results stay in their batch slots so directory
+ * order is kept.
+ *
+ */
+void CogWheelDirectoryScanner::statBatch()
+{
+
+    BatchEntry *entries = m_batch.data();
+    int entryCount = m_batch.size();
+    int taskCount = qMin(m_statThreadCount, entryCount);
+
+    if (taskCount <= 1) {
+        statEntries(entries, entryCount, 0, 1);
+        return;
+    }
+
+    QSemaphore tasksDone;
+
+    for (int task=1; task < taskCount; task++) {
+        m_statPool.start(new CogWheelStatTask(this, entries, entryCount, task, taskCount, &tasksDone));
+    }
+
+    statEntries(entries, entryCount, 0, taskCount);
+
+    tasksDone.acquire(taskCount-1);
+
+}
+
+/**
+ * @brief CogWheelDirectoryScanner::statEntries
+ *
+ * Stat every stride'th batch entry starting at first.
+ *
+ * @param entries       Batch entries.
+ * @param entryCount    Number of batch entries.
+ * @param first         First entry to stat.
+ * @param stride        Entries between each stat.
+ */
+void CogWheelDirectoryScanner::statEntries(BatchEntry *entries, int entryCount, int first, int stride) const
+{
+
+    for (int entryIndex=first; entryIndex < entryCount; entryIndex += stride) {
+
+        BatchEntry &entry = entries[entryIndex];
+
+#ifdef Q_OS_LINUX
+
+        entry.valid = statAt(m_directoryDescriptor, entry.name.constData(), m_facts, entry.fileStat);
+
+        if (entry.valid) {
+            if (entry.typeUnknown) {
+                entry.fileStat.isSymLink = isSymLinkAt(m_directoryDescriptor, entry.name.constData());
+            } else {
+                entry.fileStat.isSymLink = entry.isSymLink;
+            }
+            entry.fileStat.fileName = encodedNameToUtf8(entry.name);
+        }
+
+#else
+
+        entry.valid = statFile(m_path+"/"+QFile::decodeName(entry.name), entry.fileStat);
+
+#endif
+
+    }
+
+}
+
+/**
+ * @brief CogWheelDirectoryScanner::statFile
+ *
+ * Stat a single file.
+ *
+ * @param fileName  Local file name.
+ * @param fileStat  Returned file metadata.
+ * @param facts     Facts needed from stat.
+ *
+ * @return  == true file exists (directory or regular file).
+ */
+bool CogWheelDirectoryScanner::statFile(const QString &fileName, CogWheelFileStat &fileStat, quint32 facts)
+{
+
+#ifdef Q_OS_LINUX
+
+    QByteArray encodedFileName { QFile::encodeName(fileName) };
+
+    if (!statAt(AT_FDCWD, encodedFileName.constData(), facts, fileStat)) {
+        return(false);
+    }
+
+    fileStat.isSymLink = isSymLinkAt(AT_FDCWD, encodedFileName.constData());
+    fileStat.fileName = QFileInfo(fileName).fileName().toUtf8();
+
+    return(true);
+
+#else
+
+    Q_UNUSED(facts);
+
+    QFileInfo fileInfo { fileName };
+
+    if (!fileInfo.exists()) {
+        return(false);
+    }
+
+    statFile(fileInfo, fileStat);
+
+    return(true);
+
+#endif
+
+}
+
+/**
+ * @brief CogWheelDirectoryScanner::statFile
+ *
+ * Fill file metadata from QFileInfo.
+ *
+ * @param fileInfo  File information.
+ * @param fileStat  Returned file metadata.
+ */
+void CogWheelDirectoryScanner::statFile(const QFileInfo &fileInfo, CogWheelFileStat &fileStat)
+{
+
+    QFile::Permissions permissions { fileInfo.permissions() };
+
+    fileStat.fileName = fileInfo.fileName().toUtf8();
+    fileStat.isDir = fileInfo.isDir();
+    fileStat.isSymLink = fileInfo.isSymLink();
+    fileStat.permissions = ((permissions & QFile::ReadUser) ? 0400 : 0) |
+                           ((permissions & QFile::WriteUser) ? 0200 : 0) |
+                           ((permissions & QFile::ExeUser) ? 0100 : 0) |
+                           ((permissions & QFile::ReadGroup) ? 0040 : 0) |
+                           ((permissions & QFile::WriteGroup) ? 0020 : 0) |
+                           ((permissions & QFile::ExeGroup) ? 0010 : 0) |
+                           ((permissions & QFile::ReadOther) ? 0004 : 0) |
+                           ((permissions & QFile::WriteOther) ? 0002 : 0) |
+                           ((permissions & QFile::ExeOther) ? 0001 : 0);
+    fileStat.size = static_cast<quint64>(fileInfo.size());
+    fileStat.modifyTime = fileInfo.lastModified().toMSecsSinceEpoch();
+    fileStat.createTime = fileInfo.created().toMSecsSinceEpoch();
+    fileStat.ownerId = fileInfo.ownerId();
+    fileStat.groupId = fileInfo.groupId();
+
+}
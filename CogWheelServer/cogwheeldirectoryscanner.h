@@ -0,0 +1,120 @@
+/*
+ * File:   cogwheeldirectoryscanner.h
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+#ifndef COGWHEELDIRECTORYSCANNER_H
+#define COGWHEELDIRECTORYSCANNER_H
+
+//
+// Class: CogWheelDirectoryScanner
+//
+// Description: Class to read the entries of a directory (unsorted) along with just
+// the file metadata needed by the listing commands. On Linux entries are read in
+// batches with getdents64 and each is stat'ed once with statx relative to the open
+// directory; elsewhere QDirIterator/QFileInfo are used. Only directories and regular
+// files (or symbolic links to them) are returned as with the default QDir filter.
+// Entries are read a batch at a time and if a stat pool has been configured (for
+// network filesystems where each stat is a round trip) the batch is stat'ed
+// concurrently on it; entries are still returned in directory order.
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheel.h"
+
+#include <QString>
+#include <QByteArray>
+#include <QFileInfo>
+#include <QScopedPointer>
+#include <QDirIterator>
+#include <QVector>
+#include <QThreadPool>
+
+// File metadata used by listings
+
+struct CogWheelFileStat {
+    QByteArray fileName;            // File name as UTF-8 (no path)
+    bool isDir=false;               // == true directory
+    bool isSymLink=false;           // == true symbolic link
+    quint32 permissions=0;          // Unix permission bits (07777)
+    quint64 size=0;                 // Size in bytes
+    qint64 modifyTime=0;            // Last modified (msecs since epoch)
+    qint64 createTime=0;            // Created (msecs since epoch)
+    uint ownerId=0;                 // Owner user id
+    uint groupId=0;                 // Owner group id
+};
+
+// =================
+// CLASS DECLARATION
+// =================
+
+class CogWheelDirectoryScanner
+{
+
+public:
+
+    // Constructor / Destructor
+
+    CogWheelDirectoryScanner(const QString &path, bool includeDotEntries, quint32 facts=kCWFactAll);
+    ~CogWheelDirectoryScanner();
+
+    // Next entry (false == no more)
+
+    bool next(CogWheelFileStat &fileStat);
+
+    // Stat a single file
+
+    static bool statFile(const QString &fileName, CogWheelFileStat &fileStat, quint32 facts=kCWFactAll);
+    static void statFile(const QFileInfo &fileInfo, CogWheelFileStat &fileStat);
+
+    // Set number of parallel stat pool threads (0 == stat sequentially)
+
+    static void setStatThreadCount(int threadCount);
+
+private:
+
+    friend class CogWheelStatTask;
+
+    // Directory entry read but not yet returned
+
+    struct BatchEntry {
+        QByteArray name;                // Encoded file name
+        bool isSymLink=false;           // == true symbolic link (from directory entry)
+        bool typeUnknown=false;         // == true entry type not known
+        bool valid=false;               // == true stat'ed (directory or regular file)
+        CogWheelFileStat fileStat;      // File metadata
+    };
+
+    // Read next batch of entry names
+
+    bool readBatch();
+
+    // Stat batch entries (in parallel if pool threads)
+
+    void statBatch();
+    void statEntries(BatchEntry *entries, int entryCount, int first, int stride) const;
+
+    bool m_includeDotEntries=false;             // == true return . and ..
+    quint32 m_facts=kCWFactAll;                 // Facts needed from stat
+    QString m_path;                             // Local directory path
+    int m_directoryDescriptor=-1;               // Open directory (Linux)
+    QByteArray m_entryBuffer;                   // getdents64 buffer (Linux)
+    QScopedPointer<QDirIterator> m_directory;   // Directory iterator (not Linux)
+    QVector<BatchEntry> m_batch;                // Current batch of entries
+    int m_batchPosition=0;                      // Next entry in batch to return
+
+    static QThreadPool m_statPool;              // Shared parallel stat thread pool
+    static int m_statThreadCount;               // Pool thread count (0 == disabled)
+
+};
+
+#endif // COGWHEELDIRECTORYSCANNER_H
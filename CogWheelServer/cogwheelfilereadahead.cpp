@@ -0,0 +1,274 @@
+/*
+ * File:   cogwheelfilereadahead.cpp
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+//
+// Class: CogWheelFileReadAhead
+//
+// Description: Class to read the blocks of a file being downloaded ahead of
+// them being needed by the data channel. The reads are performed on a thread
+// pool shared by all connections so that a slow disk does not stall the
+// connections event loop; up to kCWReadAheadBlocks are kept ready (double buffered)
+// and blockReady() is signalled as each arrives.
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheelfilereadahead.h"
+#include "cogwheellogger.h"
+
+#include <QRunnable>
+#include <QMetaObject>
+
+// =================
+// LOCAL DEFINITIONS
+// =================
+
+//
+// Read ahead pool task. Reads the next block from the shared file and posts it
+// back to the owner (if still present) on the owners thread. Only one task per
+// file is ever queued so file access does not need to be locked.
+//
+
+class CogWheelReadAheadTask : public QRunnable
+{
+
+public:
+
+    CogWheelReadAheadTask(QSharedPointer<CogWheelFileReadAhead::SharedState> state, qint64 blockSize)
+        : m_state(state), m_blockSize(blockSize) { }
+
+    void run() override
+    {
+
+        QByteArray block(static_cast<int>(m_blockSize), Qt::Uninitialized);
+        qint64 bytesRead = m_state->file.read(block.data(), m_blockSize);
+
+        if (bytesRead >= 0) {
+            block.resize(static_cast<int>(bytesRead));
+        } else {
+            block.clear();
+        }
+
+        QMutexLocker ownerLock { &m_state->mutex };
+
+        if (m_state->owner) {
+            QMetaObject::invokeMethod(m_state->owner, "blockRead", Qt::QueuedConnection,
+                                      Q_ARG(QByteArray, block), Q_ARG(bool, (bytesRead < 0)));
+        }
+
+    }
+
+private:
+    QSharedPointer<CogWheelFileReadAhead::SharedState> m_state;  // Shared file state
+    qint64 m_blockSize;                                         // Block size to read
+
+};
+
+// ====================
+// CLASS IMPLEMENTATION
+// ====================
+
+// Shared read ahead thread pool and its size
+
+QThreadPool CogWheelFileReadAhead::m_readAheadPool;
+int CogWheelFileReadAhead::m_threadCount=kCWReadAheadThreads;
+
+/**
+ * @brief CogWheelFileReadAhead::CogWheelFileReadAhead
+ *
+ * Create read ahead for a file.
+ *
+ * @param fileName      File to read.
+ * @param fileOffset    Offset to start reading from.
+ * @param blockSize     Size of blocks to read.
+ * @param parent        Parent object.
+ */
+CogWheelFileReadAhead::CogWheelFileReadAhead(const QString &fileName, qint64 fileOffset, qint64 blockSize, QObject *parent)
+    : QObject(parent), m_state(new SharedState), m_fileOffset(fileOffset), m_blockSize(blockSize)
+{
+    m_state->file.setFileName(fileName);
+}
+
+/**
+ * @brief CogWheelFileReadAhead::~CogWheelFileReadAhead
+ *
+ * Destructor. Stop any queued reads posting back.
+ *
+ */
+CogWheelFileReadAhead::~CogWheelFileReadAhead()
+{
+    stop();
+}
+
+/**
+ * @brief CogWheelFileReadAhead::setThreadCount
+ *
+ * Set the number of threads in the shared read ahead pool. A count
+ * of zero disables read ahead.
+ *
+ * @param threadCount   Number of pool threads.
+ */
+void CogWheelFileReadAhead::setThreadCount(int threadCount)
+{
+    m_threadCount = threadCount;
+    if (m_threadCount > 0) {
+        m_readAheadPool.setMaxThreadCount(m_threadCount);
+    }
+}
+
+/**
+ * @brief CogWheelFileReadAhead::isEnabled
+ *
+ * @return  == true read ahead enabled.
+ */
+bool CogWheelFileReadAhead::isEnabled()
+{
+    return(m_threadCount > 0);
+}
+
+/**
+ * @brief CogWheelFileReadAhead::start
+ *
+ * Open file, seek to start offset and queue first read.
+ *
+ * @return  == true read ahead started.
+ */
+bool CogWheelFileReadAhead::start()
+{
+
+    if (!m_state->file.open(QFile::ReadOnly)) {
+        cogWheelError("Read ahead could not open file "+m_state->file.fileName()+".");
+        return(false);
+    }
+
+    if ((m_fileOffset > 0) && !m_state->file.seek(m_fileOffset)) {
+        cogWheelError("Read ahead could not seek file "+m_state->file.fileName()+".");
+        return(false);
+    }
+
+    m_state->owner = this;
+
+    scheduleRead();
+
+    return(true);
+
+}
+
+/**
+ * @brief CogWheelFileReadAhead::stop
+ *
+ * Stop read ahead. Any read in progress completes but is discarded.
+ *
+ */
+void CogWheelFileReadAhead::stop()
+{
+    QMutexLocker ownerLock { &m_state->mutex };
+    m_state->owner = nullptr;
+    m_endOfFile = true;
+}
+
+/**
+ * @brief CogWheelFileReadAhead::nextBlock
+ *
+ * Take the next block ready to send (if any) and queue a read to replace it.
+ *
+ * @param block     Block returned.
+ *
+ * @return  == true block returned.
+ */
+bool CogWheelFileReadAhead::nextBlock(QByteArray &block)
+{
+
+    if (m_readyBlocks.isEmpty()) {
+        return(false);
+    }
+
+    block = m_readyBlocks.dequeue();
+
+    scheduleRead();
+
+    return(true);
+
+}
+
+/**
+ * @brief CogWheelFileReadAhead::scheduleRead
+ *
+ * Queue a read of the next block on the pool if there is room in the
+ * ready queue and one is not already in progress.
+ *
+ */
+void CogWheelFileReadAhead::scheduleRead()
+{
+
+    if (m_readPending || m_endOfFile || (m_readyBlocks.size() >= kCWReadAheadBlocks)) {
+        return;
+    }
+
+    m_readPending = true;
+
+    m_readAheadPool.start(new CogWheelReadAheadTask(m_state, m_blockSize));
+
+}
+
+/**
+ * @brief CogWheelFileReadAhead::blockRead
+ *
+ * Block read completed on pool; queue it (an empty block is end of file),
+ * schedule next read and signal block ready.
+ *
+ * @param block     Block read.
+ * @param error     == true read failed.
+ */
+void CogWheelFileReadAhead::blockRead(const QByteArray &block, bool error)
+{
+
+    m_readPending = false;
+
+    if (error) {
+        cogWheelError("Read ahead error reading file "+m_state->file.fileName()+".");
+        m_error = true;
+        m_endOfFile = true;
+    } else if (block.isEmpty()) {
+        m_endOfFile = true;
+    } else {
+        m_readyBlocks.enqueue(block);
+        scheduleRead();
+    }
+
+    emit blockReady();
+
+}
+
+// ============================
+// CLASS PRIVATE DATA ACCESSORS
+// ============================
+
+/**
+ * @brief CogWheelFileReadAhead::isFinished
+ *
+ * @return  == true no more blocks will become ready.
+ */
+bool CogWheelFileReadAhead::isFinished() const
+{
+    return(m_endOfFile && !m_readPending && m_readyBlocks.isEmpty());
+}
+
+/**
+ * @brief CogWheelFileReadAhead::isError
+ * @return
+ */
+bool CogWheelFileReadAhead::isError() const
+{
+    return m_error;
+}
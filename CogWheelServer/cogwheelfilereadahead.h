@@ -0,0 +1,109 @@
+/*
+ * File:   cogwheelfilereadahead.h
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+#ifndef COGWHEELFILEREADAHEAD_H
+#define COGWHEELFILEREADAHEAD_H
+
+//
+// Class: CogWheelFileReadAhead
+//
+// Description: Class to read the blocks of a file being downloaded ahead of
+// them being needed by the data channel. The reads are performed on a thread
+// pool shared by all connections so that a slow disk does not stall the
+// connections event loop; up to kCWReadAheadBlocks are kept ready (double buffered)
+// and blockReady() is signalled as each arrives.
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheel.h"
+
+#include <QObject>
+#include <QFile>
+#include <QQueue>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QThreadPool>
+
+// =================
+// CLASS DECLARATION
+// =================
+
+class CogWheelFileReadAhead : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    // File state shared with read ahead pool tasks
+
+    struct SharedState {
+        QMutex mutex;                               // Owner access mutex
+        CogWheelFileReadAhead *owner=nullptr;       // == nullptr then read ahead stopped
+        QFile file;                                 // File being read
+    };
+
+    // Constructor / Destructor
+
+    explicit CogWheelFileReadAhead(const QString &fileName, qint64 fileOffset, qint64 blockSize, QObject *parent = nullptr);
+    ~CogWheelFileReadAhead();
+
+    // Read ahead pool setup
+
+    static void setThreadCount(int threadCount);
+    static bool isEnabled();
+
+    // Start/stop read ahead
+
+    bool start();
+    void stop();
+
+    // Take next ready block
+
+    bool nextBlock(QByteArray &block);
+
+    // Private data accessors
+
+    bool isFinished() const;
+    bool isError() const;
+
+signals:
+
+    void blockReady();          // Block read and ready
+
+private:
+
+    // Queue read of next block on pool
+
+    void scheduleRead();
+
+private slots:
+
+    void blockRead(const QByteArray &block, bool error);
+
+private:
+
+    QSharedPointer<SharedState> m_state;    // State shared with pool tasks
+    qint64 m_fileOffset=0;                  // Initial file offset
+    qint64 m_blockSize=0;                   // Read block size
+    QQueue<QByteArray> m_readyBlocks;       // Blocks read and ready to send
+    bool m_readPending=false;               // == true read queued on pool
+    bool m_endOfFile=false;                 // == true no more blocks to read
+    bool m_error=false;                     // == true file read error
+
+    static QThreadPool m_readAheadPool;     // Shared read ahead thread pool
+    static int m_threadCount;               // Pool thread count (0 == disabled)
+
+};
+
+#endif // COGWHEELFILEREADAHEAD_H
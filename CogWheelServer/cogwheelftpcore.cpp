@@ -17,14 +17,12 @@
 // two parameters the first which is a pointer to the control channel instance and
 // the second a string containing the commands arguments.
 //
-// Two tables exist that are indexed by command string onto the relevant
-// command. The first tabel contains the commands that maybe used in an unauthorised
-// mode (minimum) and the second which contains all commands (full) for when a user
-// has been authorised either through USER/PASSWORD or logging on anonymously.
-//
-// A third table contains FTP command extensions and that are kept separate but entries
-// are copied to the main table on initialisation.
-//
+// The commands are held in a single constant table sorted on the command verb
+// (packed into a 32 bit key) which is binary searched for each command. Each
+// entry carries flags that say whether the command needs the user to have been
+// authorised (either through USER/PASSWORD or logging on anonymously), whether
+// it is only available if TLS/SSL is enabled and whether it is an FTP command
+// extension (listed by FEAT).
 //
 
 // =============
@@ -34,6 +32,9 @@
 #include "cogwheelftpcore.h"
 #include "cogwheelftpcoreutil.h"
 #include "cogwheellogger.h"
+#include "cogwheeluserdirectory.h"
+#include "cogwheeldirectorylisting.h"
+#include "cogwheelrecursivelisting.h"
 
 // =======
 // IMPORTS
@@ -47,25 +48,24 @@ namespace FTPUtil = CogWheelFTPCoreUtil;
 // CLASS IMPLEMENTATION
 // ====================
 
-// Unathorised command table (minimum)
-
-QHash<QString, CogWheelFTPCore::FTPCommandFunction> CogWheelFTPCore::m_unauthCommandTable;
-
-// Authorised command table (full)
-
-QHash<QString, CogWheelFTPCore::FTPCommandFunction> CogWheelFTPCore::m_ftpCommandTable;
-
-// Extended command table
+// Command table sorted on verb (checked at compile time)
 
-QHash<QString, CogWheelFTPCore::FTPCommandFunction> CogWheelFTPCore::m_ftpCommandTableExtended;
+template <typename T, int N> constexpr bool isSortedOnVerb(const T (&table)[N], int index=1)
+{
+    return((index >= N) || ((table[index-1].verb < table[index].verb) && isSortedOnVerb(table, index+1)));
+}
 
 // Command code message responses (taken from rfc959)
 
 QHash<quint16, QString> CogWheelFTPCore::m_ftpServerResponse;
 
+// Command code responses as sent (code, text and end of line in UTF-8)
+
+QHash<quint16, QByteArray> CogWheelFTPCore::m_ftpServerResponseBytes;
+
 // Tailored FEAT command responses (ie. AUTH reponse is AUTH TLS).
 
-QHash<QString,QString> CogWheelFTPCore::m_featTailoredRespone;
+QHash<quint32,QString> CogWheelFTPCore::m_featTailoredRespone;
 
 // FTP server settings
 
@@ -80,7 +80,6 @@ CogWheelServerSettings CogWheelFTPCore::m_serverSettings;
 CogWheelFTPCore::CogWheelFTPCore()
 {
 
-    loadFTPCommandTables();
     loadServerReponseTables();
 
 }
@@ -103,18 +102,6 @@ CogWheelFTPCore::~CogWheelFTPCore()
 void CogWheelFTPCore::setupServer(const CogWheelServerSettings &serverSettings)
 {
     m_serverSettings = serverSettings;
-
-    // Disable TLS/SSL commands
-
-    if (!serverSettings.serverSslEnabled()) {
-        m_unauthCommandTable.remove("AUTH");
-        m_unauthCommandTable.remove("PROT");
-        m_unauthCommandTable.remove("PBSZ");
-        m_ftpCommandTable.remove("AUTH");
-        m_ftpCommandTable.remove("PROT");
-        m_ftpCommandTable.remove("PBSZ");
-    }
-
 }
 
 /**
@@ -170,94 +157,135 @@ void CogWheelFTPCore::loadServerReponseTables()
         m_ftpServerResponse.insert(553,"Requested action not taken.");
     }
 
+    // Encode each response once so it can be sent as is
+
+    if (m_ftpServerResponseBytes.isEmpty()) {
+        for (auto response = m_ftpServerResponse.cbegin(); response != m_ftpServerResponse.cend(); ++response) {
+            m_ftpServerResponseBytes.insert(response.key(), QByteArray::number(response.key())+" "+response.value().toUtf8()+kCWEOL);
+        }
+    }
+
     if (m_featTailoredRespone.empty()) {
-        m_featTailoredRespone.insert("AUTH", "AUTH TLS");
-        m_featTailoredRespone.insert("MLSD", "MLSD Type*;Size*;Create*;Modify*;UNIX.mode*;UNIX.owner*;UNIX.group*");
-        m_featTailoredRespone.insert("MLST", "MLST Type*;Size*;Create*;Modify*;UNIX.mode*;UNIX.owner*;UNIX.group*");
+        m_featTailoredRespone.insert(packVerb("AUTH"), "AUTH TLS");
     }
 
 }
 
 /**
- * @brief CogWheelFTPCore::loadFTPCommandTable
+ * @brief CogWheelFTPCore::commandTable
+ *
+ * Return FTP command table. This is a constant table built at compile time
+ * and must be kept sorted on the packed command verb as it is binary searched.
  *
- * Load main FTP command table.
+ * @param commandCount  Number of table entries.
  *
+ * @return  Pointer to first table entry.
  */
-void CogWheelFTPCore::loadFTPCommandTables()
+const CogWheelFTPCore::FTPCommand *CogWheelFTPCore::commandTable(int &commandCount)
 {
 
-    // Miniumum command table
-
-    if (m_unauthCommandTable.isEmpty()) {
-        m_unauthCommandTable.insert("USER", USER);
-        m_unauthCommandTable.insert("PASS", PASS);
-        m_unauthCommandTable.insert("TYPE", TYPE);
-        m_unauthCommandTable.insert("FEAT", FEAT);
-        m_unauthCommandTable.insert("AUTH", AUTH);
-        m_unauthCommandTable.insert("PROT", PROT);
-        m_unauthCommandTable.insert("PBSZ", PBSZ);
-    }
-
-    // Full command table
-
-    if (m_ftpCommandTable.isEmpty()) {
-        m_ftpCommandTable.insert("USER", USER);
-        m_ftpCommandTable.insert("PASS", PASS);
-        m_ftpCommandTable.insert("LIST", LIST);
-        m_ftpCommandTable.insert("SYST", SYST);
-        m_ftpCommandTable.insert("PWD", PWD);
-        m_ftpCommandTable.insert("TYPE", TYPE);
-        m_ftpCommandTable.insert("PORT", PORT);
-        m_ftpCommandTable.insert("CWD", CWD);
-        m_ftpCommandTable.insert("CDUP", CDUP);
-        m_ftpCommandTable.insert("RETR", RETR);
-        m_ftpCommandTable.insert("MODE", MODE);
-        m_ftpCommandTable.insert("NOOP", NOOP);
-        m_ftpCommandTable.insert("STOR", STOR);
-        m_ftpCommandTable.insert("PASV", PASV);
-        m_ftpCommandTable.insert("HELP", HELP);
-        m_ftpCommandTable.insert("SITE", SITE);
-        m_ftpCommandTable.insert("NLST", NLST);
-        m_ftpCommandTable.insert("MKD", MKD);
-        m_ftpCommandTable.insert("RMD", RMD);
-        m_ftpCommandTable.insert("QUIT", QUIT);
-        m_ftpCommandTable.insert("DELE", DELE);
-        m_ftpCommandTable.insert("ACCT", ACCT);
-        m_ftpCommandTable.insert("STOU", STOU);
-        m_ftpCommandTable.insert("STRU", STRU);
-        m_ftpCommandTable.insert("SMNT", SMNT);
-        m_ftpCommandTable.insert("ALLO", ALLO);
-        m_ftpCommandTable.insert("RNFR", RNFR);
-        m_ftpCommandTable.insert("RNTO", RNTO);
-        m_ftpCommandTable.insert("REST", REST);
-        m_ftpCommandTable.insert("ABOR", ABOR);
-        m_ftpCommandTable.insert("REIN", REIN);
-        m_ftpCommandTable.insert("APPE", APPE);
-        m_ftpCommandTable.insert("STAT", STAT);
-    }
-
-    // Add extended commands to main table
-
-    if (m_ftpCommandTableExtended.isEmpty()) {
-
-        m_ftpCommandTableExtended.insert("FEAT", FEAT);
-        m_ftpCommandTableExtended.insert("MDTM", MDTM);
-        m_ftpCommandTableExtended.insert("SIZE", SIZE);
-        m_ftpCommandTableExtended.insert("AUTH", AUTH);
-        m_ftpCommandTableExtended.insert("PROT", PROT);
-        m_ftpCommandTableExtended.insert("PBSZ", PBSZ);
-        m_ftpCommandTableExtended.insert("MLSD", MLSD);
-        m_ftpCommandTableExtended.insert("MLST", MLST);
-
-        QHashIterator<QString, FTPCommandFunction> command(m_ftpCommandTableExtended);
-        while(command.hasNext()) {
-            command.next();
-            m_ftpCommandTable.insert(command.key(), command.value());
+    static constexpr FTPCommand ftpCommands[] {
+        { packVerb("ABOR"), ABOR, kCWCommandNeedsAuth },
+        { packVerb("ACCT"), ACCT, kCWCommandNeedsAuth },
+        { packVerb("ALLO"), ALLO, kCWCommandNeedsAuth },
+        { packVerb("APPE"), APPE, kCWCommandNeedsAuth },
+        { packVerb("AUTH"), AUTH, kCWCommandNeedsTLS|kCWCommandExtended },
+        { packVerb("CDUP"), CDUP, kCWCommandNeedsAuth },
+        { packVerb("CWD"),  CWD,  kCWCommandNeedsAuth },
+        { packVerb("DELE"), DELE, kCWCommandNeedsAuth },
+        { packVerb("FEAT"), FEAT, kCWCommandExtended },
+        { packVerb("HELP"), HELP, kCWCommandNeedsAuth },
+        { packVerb("LIST"), LIST, kCWCommandNeedsAuth },
+        { packVerb("MDTM"), MDTM, kCWCommandNeedsAuth|kCWCommandExtended },
+        { packVerb("MKD"),  MKD,  kCWCommandNeedsAuth },
+        { packVerb("MLSD"), MLSD, kCWCommandNeedsAuth|kCWCommandExtended },
+        { packVerb("MLST"), MLST, kCWCommandNeedsAuth|kCWCommandExtended },
+        { packVerb("MODE"), MODE, kCWCommandNeedsAuth },
+        { packVerb("NLST"), NLST, kCWCommandNeedsAuth },
+        { packVerb("NOOP"), NOOP, kCWCommandNeedsAuth },
+        { packVerb("OPTS"), OPTS, 0 },
+        { packVerb("PASS"), PASS, 0 },
+        { packVerb("PASV"), PASV, kCWCommandNeedsAuth },
+        { packVerb("PBSZ"), PBSZ, kCWCommandNeedsTLS|kCWCommandExtended },
+        { packVerb("PORT"), PORT, kCWCommandNeedsAuth },
+        { packVerb("PROT"), PROT, kCWCommandNeedsTLS|kCWCommandExtended },
+        { packVerb("PWD"),  PWD,  kCWCommandNeedsAuth },
+        { packVerb("QUIT"), QUIT, kCWCommandNeedsAuth },
+        { packVerb("REIN"), REIN, kCWCommandNeedsAuth },
+        { packVerb("REST"), REST, kCWCommandNeedsAuth },
+        { packVerb("RETR"), RETR, kCWCommandNeedsAuth },
+        { packVerb("RMD"),  RMD,  kCWCommandNeedsAuth },
+        { packVerb("RNFR"), RNFR, kCWCommandNeedsAuth },
+        { packVerb("RNTO"), RNTO, kCWCommandNeedsAuth },
+        { packVerb("SITE"), SITE, kCWCommandNeedsAuth },
+        { packVerb("SIZE"), SIZE, kCWCommandNeedsAuth|kCWCommandExtended },
+        { packVerb("SMNT"), SMNT, kCWCommandNeedsAuth },
+        { packVerb("STAT"), STAT, kCWCommandNeedsAuth },
+        { packVerb("STOR"), STOR, kCWCommandNeedsAuth },
+        { packVerb("STOU"), STOU, kCWCommandNeedsAuth },
+        { packVerb("STRU"), STRU, kCWCommandNeedsAuth },
+        { packVerb("SYST"), SYST, kCWCommandNeedsAuth },
+        { packVerb("TYPE"), TYPE, 0 },
+        { packVerb("USER"), USER, 0 }
+    };
+
+    static_assert(isSortedOnVerb(ftpCommands), "FTP command table must be sorted on verb.");
+
+    commandCount = sizeof(ftpCommands)/sizeof(ftpCommands[0]);
+
+    return(ftpCommands);
+
+}
+
+/**
+ * @brief CogWheelFTPCore::findCommand
+ *
+ * Binary search command table for a command verb. With some forty commands
+ * this is at most six integer compares over one small constant table, so a
+ * perfect hash would not gain enough to be worth keeping in step with it.
+ *
+ * @param verb  Packed command verb.
+ *
+ * @return  Command table entry (nullptr == not found).
+ */
+const CogWheelFTPCore::FTPCommand *CogWheelFTPCore::findCommand(quint32 verb)
+{
+
+    int commandCount;
+    const FTPCommand *ftpCommands = commandTable(commandCount);
+
+    int low=0;
+    int high=commandCount;
+
+    while (low < high) {
+        int middle = (low+high)/2;
+        if (ftpCommands[middle].verb < verb) {
+            low = middle+1;
+        } else {
+            high = middle;
         }
+    }
 
+    if ((low < commandCount) && (ftpCommands[low].verb == verb)) {
+        return(&ftpCommands[low]);
     }
 
+    return(nullptr);
+
+}
+
+/**
+ * @brief CogWheelFTPCore::isCommandEnabled
+ *
+ * Commands that need TLS/SSL are disabled if it is not.
+ *
+ * @param command   Command table entry.
+ *
+ * @return  == true command enabled.
+ */
+bool CogWheelFTPCore::isCommandEnabled(const FTPCommand &command)
+{
+    return(!(command.flags & kCWCommandNeedsTLS) || m_serverSettings.serverSslEnabled());
 }
 
 /**
@@ -278,42 +306,119 @@ QString CogWheelFTPCore::getResponseText(quint16 responseCode)
     }
 }
 
+/**
+ * @brief CogWheelFTPCore::getResponseBytes
+ *
+ * Get reply as sent (code, text and end of line) for a given response
+ * code or an empty byte array if one does not exist. The bytes are shared
+ * with the table so no copy is made.
+ *
+ * @param responseCode   Server response code.
+ *
+ * @return Reponse code reply bytes.
+ */
+QByteArray CogWheelFTPCore::getResponseBytes(quint16 responseCode)
+{
+    return(m_ftpServerResponseBytes.value(responseCode));
+}
+
+/**
+ * @brief CogWheelFTPCore::parseVerb
+ *
+ * Pack a command verb received from the client into a command table key,
+ * converting it to uppercase. Verbs longer than four characters are not
+ * supported so map to an invalid key (0).
+ *
+ * @param verb          Command verb bytes.
+ * @param verbLength    Command verb length.
+ *
+ * @return  Command table key (0 == invalid).
+ */
+quint32 CogWheelFTPCore::parseVerb(const char *verb, int verbLength)
+{
+
+    quint32 key=0;
+
+    if ((verbLength < 1) || (verbLength > 4)) {
+        return(0);
+    }
+
+    for (int index=0; index < verbLength; index++) {
+        quint8 character = static_cast<quint8>(verb[index]);
+        if ((character >= 'a') && (character <= 'z')) {
+            character -= ('a'-'A');
+        }
+        key = (key<<8) | character;
+    }
+
+    return(key<<(8*(4-verbLength)));
+
+}
+
+/**
+ * @brief CogWheelFTPCore::verbName
+ *
+ * Unpack command table key back into its verb string.
+ *
+ * @param verb  Command table key.
+ *
+ * @return  Command verb.
+ */
+QString CogWheelFTPCore::verbName(quint32 verb)
+{
+
+    QString name;
+
+    for (int shift=24; shift >= 0; shift -= 8) {
+        if ((verb>>shift)&0xFF) {
+            name.append(QLatin1Char(static_cast<char>((verb>>shift)&0xFF)));
+        }
+    }
+
+    return(name);
+
+}
+
 /**
  * @brief CogWheelFTPCore::performCommand
  *
  * Execute FTP command. If the user has been authenicated then then they
- * get a full command list otherwise only a small subset. Note: This is
- * where all command exceptions are handled. If plain FTP is disabled then
- * the client must connect using explicit FTP over TLS which means it must
- * be enabled.
+ * get a full command list otherwise only those not flagged as needing
+ * authorisation. Note: This is where all command exceptions are handled.
+ * If plain FTP is disabled then the client must connect using explicit
+ * FTP over TLS which means it must be enabled.
  *
  * @param connection   Pointer to control channel instance.
- * @param command      FTP command.
+ * @param verb         FTP command (packed verb).
  * @param arguments    Command arguments.
  */
-void CogWheelFTPCore::performCommand(CogWheelControlChannel *connection, const QString &command, const QString &arguments)
+void CogWheelFTPCore::performCommand(CogWheelControlChannel *connection, quint32 verb, const QString &arguments)
 {
 
     try {
 
-        cogWheelCommand(connection->socketHandle(), command+" "+arguments);
+        // Only build log message if it is going to be logged
 
-        if (m_ftpCommandTable.contains(command)) {
+        if (getLoggingLevel() & (CogWheelLogger::Command | CogWheelLogger::Channel)) {
+            cogWheelCommand(connection->socketHandle(), verbName(verb)+" "+arguments);
+        }
 
-            FTPCommandFunction commandFn;
+        const FTPCommand *command = findCommand(verb);
 
-            if (connection->isAuthorized()) {
+        if ((command != nullptr) && isCommandEnabled(*command)) {
 
-                commandFn=m_ftpCommandTable[command];
+            if (!connection->isAuthorized()) {
 
-            } else if (m_unauthCommandTable.contains(command)) {
+                if (command->flags & kCWCommandNeedsAuth) {
+                    throw CogWheelFtpServerReply(530, "Please login with USER and PASS.");
+                }
 
                 // Plain FTP off so must connect using explicit FTP over TLS. All commands will fail
                 // until get an AUTH TLS. Note: TLS/SSL: must be enabled or commands will be ignored.
 
                 if (!m_serverSettings.serverPlainFTPEnabled()) {
                     if (m_serverSettings.serverSslEnabled() && !connection->IsSslConnection()) {
-                        if ((command != "AUTH") || (arguments != "TLS")) {
+                        if ((verb != packVerb("AUTH")) || (arguments != "TLS")) {
                             throw CogWheelFtpServerReply(550, "No plain FTP allowed. Please connect using explicit FTP over TLS.");
                         }
                     } else if (!m_serverSettings.serverSslEnabled()){
@@ -321,20 +426,12 @@ void CogWheelFTPCore::performCommand(CogWheelControlChannel *connection, const Q
                     }
                 }
 
-                commandFn=m_unauthCommandTable[command];
-
-            } else {
-                throw CogWheelFtpServerReply(530, "Please login with USER and PASS.");
             }
 
-            Q_ASSERT(commandFn!=nullptr);
-
-            if (commandFn) {
-                commandFn(connection, arguments);
-            }
+            command->function(connection, arguments);
 
         } else {
-            throw CogWheelFtpServerReply(500, "Unsupported FTP command "+command+".");
+            throw CogWheelFtpServerReply(500, "Unsupported FTP command "+verbName(verb)+".");
         }
 
     } catch (CogWheelFtpServerReply response)  {
@@ -352,8 +449,8 @@ void CogWheelFTPCore::performCommand(CogWheelControlChannel *connection, const Q
         connection->sendReplyCode(550, err.what());
     } catch(...) {
         connection->disconnectDataChannel(); // Disconnect any data channel
-        cogWheelError(connection->socketHandle(), "Unknown error handling "+command+" command.");
-        connection->sendReplyCode(550, "Unknown error handling "+command+" command.");
+        cogWheelError(connection->socketHandle(), "Unknown error handling "+verbName(verb)+" command.");
+        connection->sendReplyCode(550, "Unknown error handling "+verbName(verb)+" command.");
     }
 
 }
@@ -391,11 +488,14 @@ void CogWheelFTPCore::USER(CogWheelControlChannel *connection, const QString &ar
 
         if (m_serverSettings.serverAnonymousEnabled()) {
             connection->setAnonymous(true);
+            if (!CogWheelUserDirectory::findUser(arguments, userSettings)) {
+                userSettings.setUserName(arguments);
+            }
         } else {
             throw CogWheelFtpServerReply(530, "Anonymous logins are disabled.");
         }
 
-    } else if (!CogWheelUserSettings::checkUserName(arguments)) {
+    } else if (!CogWheelUserDirectory::findUser(arguments, userSettings)) {
 
         // User does not exist
 
@@ -403,8 +503,6 @@ void CogWheelFTPCore::USER(CogWheelControlChannel *connection, const QString &ar
 
     }
 
-    userSettings.load(arguments);
-
     // Set user name, password and write access
 
     connection->setUserName(userSettings.getUserName());
@@ -452,9 +550,18 @@ void CogWheelFTPCore::LIST(CogWheelControlChannel *connection, const QString &ar
 {
 
     // Some clients use "LIST -a" to list . files but as server does it automatically
-    // set argument to empty string (current workign directory)
+    // ignore it; "-R" (on its own or with other options) asks for a recursive listing.
+
+    QString listPath { arguments };
+    bool recursive { false };
 
-    QString path { FTPUtil::mapPathToLocal(connection, (arguments!="-a") ? arguments : "") } ;
+    while (listPath.startsWith('-')) {
+        QString options { listPath.section(' ', 0, 0) };
+        recursive = recursive || options.contains('R');
+        listPath = listPath.section(' ', 1).trimmed();
+    }
+
+    QString path { FTPUtil::mapPathToLocal(connection, listPath) } ;
     QFileInfo fileInfo { path };
 
     // Argument does not exist
@@ -467,31 +574,22 @@ void CogWheelFTPCore::LIST(CogWheelControlChannel *connection, const QString &ar
 
     if (connection->connectDataChannel()) {
 
-        QString listing;
+        // Stream files for directory (data channel closed once listing sent)
 
-        // List files for directory
+        if (fileInfo.isDir() && recursive) {
+            connection->listOnDataChannel(new CogWheelRecursiveListing(path, listPath.isEmpty() ? connection->currentWorkingDirectory() : listPath,
+                                                                       CogWheelDirectoryListing::LIST));
 
-        if (fileInfo.isDir()) {
-            QDir listDirectory { path };
-            listDirectory.setFilter(listDirectory.filter() | QDir::Hidden);
-            for (QFileInfo &item : listDirectory.entryInfoList()) {
-                listing.append(FTPUtil::buildLISTLine(item)+kCWEOL);
-            }
+        } else if (fileInfo.isDir()) {
+            connection->listOnDataChannel(new CogWheelDirectoryListing(path, CogWheelDirectoryListing::LIST));
 
             // List a single file
 
         } else {
-            listing.append(FTPUtil::buildLISTLine(fileInfo)+kCWEOL);
+            connection->sendOnDataChannel(QString(FTPUtil::buildLISTLine(fileInfo)+kCWEOL).toUtf8());
+            connection->finishOnDataChannel();
         }
 
-        // Send listing to clients
-
-        connection->sendOnDataChannel(listing.toUtf8().data());
-
-        // Disconnect data channel
-
-        connection->disconnectDataChannel();
-
     }
 
 
@@ -518,7 +616,8 @@ void CogWheelFTPCore::SYST(CogWheelControlChannel *connection, const QString &ar
 /**
  * @brief CogWheelFTPCore::PWD
  *
- * Return to the client the current woring directory.
+ * Return to the client the current woring directory. The reply is built from the
+ * UTF-8 directory kept by the connection in its reused reply buffer.
  *
  * @param connection   Pointer to control channel instance.
  * @param arguments    Command arguments.
@@ -528,9 +627,19 @@ void CogWheelFTPCore::PWD(CogWheelControlChannel *connection, const QString &arg
 
     Q_UNUSED(arguments);
 
-    cogWheelInfo(connection->socketHandle(),"PWD "+connection->currentWorkingDirectory());
+    if (getLoggingLevel() & CogWheelLogger::Channel) {
+        cogWheelInfo(connection->socketHandle(),"PWD "+connection->currentWorkingDirectory());
+    }
+
+    CogWheelReplyBuilder &reply { connection->replyBuffer() };
+    QByteArray &replyLine { reply.lineBuffer() };
+
+    replyLine.append("257 \"");
+    replyLine.append(connection->currentWorkingDirectoryUtf8());
+    replyLine.append('"');
+    reply.endLine();
 
-    connection->sendReplyCode (257, "\""+connection->currentWorkingDirectory()+"\"");
+    connection->sendReply(reply);
 
 }
 
@@ -670,7 +779,7 @@ void CogWheelFTPCore::RETR(CogWheelControlChannel *connection, const QString &ar
 
     // Connect up data channel and download file
 
-    if (connection->connectDataChannel()) {
+    if (connection->connectDataChannel(true)) {
         connection->downloadFileFromDataChannel(FTPUtil::mapPathToLocal(connection, arguments ));
     }
 
@@ -780,28 +889,35 @@ void CogWheelFTPCore::HELP(CogWheelControlChannel *connection, const QString &ar
 
     Q_UNUSED(arguments);
 
-    QString helpReply;
+    CogWheelReplyBuilder reply;
     int column=0;
+    int commandCount;
+    const FTPCommand *ftpCommands = commandTable(commandCount);
 
-    helpReply.append(static_cast<QString>("214-The following commands are available:")+kCWEOL);
+    reply.appendLine("214-The following commands are available:");
 
-    for( auto key :  m_ftpCommandTable.keys() ) {
-        helpReply.append(" "+key);
+    for (int command=0; command < commandCount; command++) {
+        if (!isCommandEnabled(ftpCommands[command])) {
+            continue;
+        }
+        reply.lineBuffer().append(" "+verbName(ftpCommands[command].verb).toUtf8());
         if (column++ == 8) {
-            helpReply.append(kCWEOL);
+            reply.endLine();
             column=0;
         }
     }
-    if (column==0) helpReply.chop(2);
-    connection->sendOnControlChannel(helpReply);
+    if (column!=0) reply.endLine();
+
+    reply.appendReplyCode(214, "Help OK.");
+    connection->sendReply(reply);
 
-    connection->sendReplyCode(214, "Help OK.");
 }
 
 /**
  * @brief CogWheelFTPCore::SITE
  *
- * No Site specific commands (so not implemented).
+ * Site specific commands. Only MLSDR (recursive MLSD) is supported; any
+ * other gets a 202 (not implemented) reply.
  *
  * @param connection   Pointer to control channel instance.
  * @param arguments    Command arguments.
@@ -809,11 +925,54 @@ void CogWheelFTPCore::HELP(CogWheelControlChannel *connection, const QString &ar
 void CogWheelFTPCore::SITE(CogWheelControlChannel *connection, const QString &arguments)
 {
 
-    Q_UNUSED(arguments);
+    QString command { arguments.section(' ', 0, 0).toUpper() };
+
+    if (command=="MLSDR") {
+        MLSDR(connection, arguments.section(' ', 1).trimmed());
+        return;
+    }
 
     connection->sendReplyCode(202);
 }
 
+/**
+ * @brief CogWheelFTPCore::MLSDR
+ *
+ * SITE MLSDR: send MLSD fact lists for a whole directory tree over one data
+ * connection. Each directory's entries are preceded by its Type=cdir fact line
+ * (carrying the directory path) so a client can rebuild the tree without a
+ * CWD/MLSD round trip per directory.
+ *
+ * @param connection   Pointer to control channel instance.
+ * @param arguments    Command arguments.
+ */
+void CogWheelFTPCore::MLSDR(CogWheelControlChannel *connection, const QString &arguments)
+{
+
+    QString path { FTPUtil::mapPathToLocal(connection, arguments) } ;
+    QFileInfo fileInfo { path };
+
+    // Argument does not exist
+
+    if (!fileInfo.exists()) {
+        throw CogWheelFtpServerReply(501, "Requested path not found.");
+    }
+
+    // Argument not a directory
+
+    if (!fileInfo.isDir()) {
+        throw CogWheelFtpServerReply(501, "Requested path not a directory.");
+    }
+
+    // Connect up data channel and stream tree (data channel closed once listing sent)
+
+    if (connection->connectDataChannel()) {
+        connection->listOnDataChannel(new CogWheelRecursiveListing(path, arguments.isEmpty() ? connection->currentWorkingDirectory() : arguments,
+                                                                   CogWheelDirectoryListing::MLSD, connection->mlstFacts()));
+    }
+
+}
+
 /**
  * @brief CogWheelFTPCore::NLST
  *
@@ -840,26 +999,15 @@ void CogWheelFTPCore::NLST(CogWheelControlChannel *connection, const QString &ar
 
     if (connection->connectDataChannel()) {
 
+        // Stream names for directory (data channel closed once listing sent)
+
         if (fileInfo.isDir()) {
-            QString listing;
-            QDir listDirectory { path };
-            listDirectory.setFilter(listDirectory.filter() | QDir::NoDotAndDotDot | QDir::NoDot | QDir::Hidden);
-            for (QString item : listDirectory.entryList()) {
-                if (arguments.endsWith("/"))  {
-                    listing.append(arguments+item+kCWEOL);
-                }else {
-                    listing.append(arguments+"/"+item+kCWEOL);
-                }
-            }
-            connection->sendOnDataChannel(listing.toUtf8().data());
+            connection->listOnDataChannel(new CogWheelDirectoryListing(path, CogWheelDirectoryListing::NLST, arguments));
         } else {
-           connection->sendOnDataChannel(QString(arguments+kCWEOL).toUtf8().data());
+           connection->sendOnDataChannel(QString(arguments+kCWEOL).toUtf8());
+           connection->finishOnDataChannel();
         }
 
-        // Disconnect data channel
-
-        connection->disconnectDataChannel();
-
     }
 
 }
@@ -1247,6 +1395,7 @@ void CogWheelFTPCore::REIN(CogWheelControlChannel *connection, const QString &ar
     connection->setRestoreFilePostion(0);
     connection->setRenameFromFileName("");
     connection->setDataChanelProtection('C');
+    connection->setMLSTFacts(kCWFactAll);
 
     connection->sendReplyCode(250);
 
@@ -1291,23 +1440,27 @@ void CogWheelFTPCore::STAT(CogWheelControlChannel *connection, const QString &ar
 
     if(!arguments.isEmpty()) {
 
-        connection->sendOnControlChannel("213-Status of "+arguments);
+        CogWheelReplyBuilder reply;
+
+        reply.appendLine("213-Status of "+arguments);
 
         QFileInfo fileInfo { FTPUtil::mapPathToLocal(connection, arguments) };
 
         if (fileInfo.isDir()) {
 
-            QDir listDirectory { fileInfo .absolutePath() };
-            listDirectory.setFilter(listDirectory.filter() | QDir::Hidden);
-            for (QFileInfo &item : listDirectory.entryInfoList()) {
-                connection->sendOnControlChannel(FTPUtil::buildLISTLine(item));
+            CogWheelDirectoryScanner listDirectory { fileInfo.absoluteFilePath(), true };
+            CogWheelFileStat item;
+            while (listDirectory.next(item)) {
+                FTPUtil::appendLISTLine(reply.lineBuffer(), item);
+                reply.endLine();
             }
 
         } else if (fileInfo.isFile()){
-           connection->sendOnControlChannel(FTPUtil::buildLISTLine(fileInfo));
+            reply.appendLine(FTPUtil::buildLISTLine(fileInfo));
         }
 
-        connection->sendReplyCode(213);
+        reply.appendReplyCode(213, getResponseText(213));
+        connection->sendReply(reply);
 
         return;
 
@@ -1324,20 +1477,22 @@ void CogWheelFTPCore::STAT(CogWheelControlChannel *connection, const QString &ar
     // No File transfer and no argument
 
     if(!connection->dataChannel() && arguments.isEmpty()) {
-        connection->sendOnControlChannel("213- "+ m_serverSettings.serverName()+" ("+connection->serverIP()+ ") FTP Server Status:");
-        connection->sendOnControlChannel("Version "+ m_serverSettings.serverVersion());
-        connection->sendOnControlChannel("Connected from "+connection->clientHostIP());
+        CogWheelReplyBuilder reply;
+        reply.appendLine("213- "+ m_serverSettings.serverName()+" ("+connection->serverIP()+ ") FTP Server Status:");
+        reply.appendLine("Version "+ m_serverSettings.serverVersion());
+        reply.appendLine("Connected from "+connection->clientHostIP());
         if (connection->isAnonymous()) {
-            connection->sendOnControlChannel("Logged in anonymously.");
+            reply.appendLine("Logged in anonymously.");
         } else {
-            connection->sendOnControlChannel("Logged in as user "+connection->userName());
+            reply.appendLine("Logged in as user "+connection->userName());
         }
         if (connection->dataChannel()==nullptr) {
-            connection->sendOnControlChannel("No data connection.");
+            reply.appendLine("No data connection.");
         }else {
-            connection->sendOnControlChannel("Trasferring data.");
+            reply.appendLine("Trasferring data.");
         }
-        connection->sendReplyCode(213);
+        reply.appendReplyCode(213, getResponseText(213));
+        connection->sendReply(reply);
     }
 
 }
@@ -1359,20 +1514,63 @@ void CogWheelFTPCore::FEAT(CogWheelControlChannel *connection, const QString &ar
 
     Q_UNUSED(arguments);
 
-    connection->sendOnControlChannel("211-Extensions supported: ");
+    CogWheelReplyBuilder reply;
+    int commandCount;
+    const FTPCommand *ftpCommands = commandTable(commandCount);
+
+    reply.appendLine("211-Extensions supported: ");
 
-    for( auto key :  m_ftpCommandTableExtended.keys() ) {
-        if (!m_featTailoredRespone.contains(key))  {
-            connection->sendOnControlChannel(" "+key);
+    for (int command=0; command < commandCount; command++) {
+        quint32 key = ftpCommands[command].verb;
+        if (!(ftpCommands[command].flags & kCWCommandExtended) || !isCommandEnabled(ftpCommands[command])) {
+            continue;
+        }
+        if ((key==packVerb("MLSD")) || (key==packVerb("MLST"))) {
+            reply.appendLine(" "+verbName(key)+" "+FTPUtil::buildMLSTFactNames(connection->mlstFacts(), true));
+        } else if (!m_featTailoredRespone.contains(key))  {
+            reply.appendLine(" "+verbName(key));
         } else {
-            connection->sendOnControlChannel(" "+m_featTailoredRespone[key]);
+            reply.appendLine(" "+m_featTailoredRespone[key]);
         }
     }
 
-    connection->sendOnControlChannel(" REST STREAM");
-    connection->sendOnControlChannel(" TVFS");
+    reply.appendLine(" REST STREAM");
+    reply.appendLine(" TVFS");
 
-    connection->sendReplyCode(211, "End.");
+    reply.appendReplyCode(211, "End.");
+    connection->sendReply(reply);
+
+}
+
+/**
+ * @brief CogWheelFTPCore::OPTS
+ *
+ * Set options for a command. OPTS MLST selects the facts returned by
+ * MLST/MLSD for the rest of the session (only those facts are then
+ * fetched and formatted); the facts now selected are returned. OPTS
+ * UTF8 ON is accepted as paths are always UTF-8.
+ *
+ * @param connection   Pointer to control channel instance.
+ * @param arguments    Command arguments.
+ */
+void CogWheelFTPCore::OPTS(CogWheelControlChannel *connection, const QString &arguments)
+{
+
+    QString command { arguments.section(' ', 0, 0).toUpper() };
+    QString options { arguments.section(' ', 1).trimmed() };
+
+    if (command=="MLST") {
+        connection->setMLSTFacts(FTPUtil::parseMLSTFacts(options));
+        connection->sendReplyCode(200, ("MLST OPTS "+FTPUtil::buildMLSTFactNames(connection->mlstFacts(), false)).trimmed());
+        return;
+    }
+
+    if ((command=="UTF8") && (options.toUpper()=="ON")) {
+        connection->sendReplyCode(200, "Always in UTF8 mode.");
+        return;
+    }
+
+    connection->sendReplyCode(501, "Option not understood.");
 
 }
 
@@ -1522,28 +1720,11 @@ void CogWheelFTPCore::MLSD(CogWheelControlChannel *connection, const QString &ar
 
     if (connection->connectDataChannel()) {
 
-        QString listing;
-
-        // List files for directory
-
-        listing.append(FTPUtil::buildPathFactList( fileInfo, arguments)+kCWEOL);
-
-        if (fileInfo.isDir()) {
-            QDir listDirectory { path };
-            listDirectory.setFilter(listDirectory.filter() | QDir::Hidden);
-            for (QFileInfo &item : listDirectory.entryInfoList()) {
-                listing.append(FTPUtil::buildFileFactList(item)+kCWEOL);
-            }
-
-        }
-
-        // Send listing to clients
-
-        connection->sendOnDataChannel(listing.toUtf8().data());
-
-        // Disconnect data channel
+        // Directory facts then stream files for directory (data channel closed once listing sent)
 
-        connection->disconnectDataChannel();
+        connection->sendOnDataChannel(QString(FTPUtil::buildPathFactList( fileInfo, arguments, connection->mlstFacts())+kCWEOL).toUtf8());
+        connection->listOnDataChannel(new CogWheelDirectoryListing(path, CogWheelDirectoryListing::MLSD, QString(),
+                                                                   connection->mlstFacts()));
 
     }
 
@@ -1560,12 +1741,15 @@ void CogWheelFTPCore::MLSD(CogWheelControlChannel *connection, const QString &ar
 void CogWheelFTPCore::MLST(CogWheelControlChannel *connection, const QString &arguments)
 {
 
-    QFileInfo fileInfo(FTPUtil::mapPathToLocal(connection, arguments));
+    CogWheelFileStat fileStat;
 
-    if(fileInfo.exists()) {
-        connection->sendOnControlChannel("250-Listing "+arguments);
-        connection->sendOnControlChannel(FTPUtil::buildFileFactList(fileInfo));
-        connection->sendReplyCode(250,"End.");
+    if(CogWheelDirectoryScanner::statFile(FTPUtil::mapPathToLocal(connection, arguments), fileStat, connection->mlstFacts())) {
+        CogWheelReplyBuilder reply;
+        reply.appendLine("250-Listing "+arguments);
+        FTPUtil::appendFileFactList(reply.lineBuffer(), fileStat, connection->mlstFacts());
+        reply.endLine();
+        reply.appendReplyCode(250,"End.");
+        connection->sendReply(reply);
     } else {
         connection->sendReplyCode(501, "File does not exist.");
     }
@@ -20,14 +20,12 @@
 // two parameters the first which is a pointer to the control channel instance and
 // the second a string containing the commands arguments.
 //
-// Two tables exist that are indexed by command string onto the relevant
-// command. The first tabel contains the commands that maybe used in an unauthorised
-// mode (minimum) and the second which contains all commands (full) for when a user
-// has been authorised either through USER/PASSWORD or logging on anonymously.
-//
-// A third table contains FTP command extensions and that are kept separate but entries
-// are copied to the main table on initialisation.
-//
+// The commands are held in a single constant table sorted on the command verb
+// (packed into a 32 bit key) which is binary searched for each command. Each
+// entry carries flags that say whether the command needs the user to have been
+// authorised (either through USER/PASSWORD or logging on anonymously), whether
+// it is only available if TLS/SSL is enabled and whether it is an FTP command
+// extension (listed by FEAT).
 //
 
 // =============
@@ -38,8 +36,6 @@
 #include "cogwheelusersettings.h"
 #include "cogwheelftpserverreply.h"
 
-#include <functional>
-
 #include <QHash>
 #include <QString>
 
@@ -71,24 +67,47 @@ public:
 
     static void setupServer(const CogWheelServerSettings &serverSettings);
 
-    // Response table accessor
+    // Response table accessors
 
     static QString getResponseText(quint16 responseCode);
+    static QByteArray getResponseBytes(quint16 responseCode);
+
+    // Pack command verb (up to 4 characters, left aligned) into a command table key
+
+    static constexpr quint32 packVerb(const char *verb, quint32 key=0, int index=0) {
+        return((index==4) ? key : (verb[index]=='\0') ? key<<(8*(4-index)) :
+                                  packVerb(verb, (key<<8)|static_cast<quint8>(verb[index]), index+1));
+    }
+    static quint32 parseVerb(const char *verb, int verbLength);
+    static QString verbName(quint32 verb);
 
     // Perform FTP command
 
-    static void performCommand(CogWheelControlChannel *connection, const QString &command, const QString &arguments);
+    static void performCommand(CogWheelControlChannel *connection, quint32 verb, const QString &arguments);
 
 private:
 
     // FTP command function pointer
 
-    using FTPCommandFunction = std::function<void (CogWheelControlChannel *, const QString &)>;
+    using FTPCommandFunction = void (*)(CogWheelControlChannel *, const QString &);
+
+    // Command table entry
+
+    struct FTPCommand {
+        quint32 verb;                   // Packed command verb
+        FTPCommandFunction function;    // Command function
+        quint32 flags;                  // Command flags
+    };
 
     // Setup tables
 
     static void loadServerReponseTables();
-    static void loadFTPCommandTables();
+
+    // Command table (sorted on verb) and lookup
+
+    static const FTPCommand *commandTable(int &commandCount);
+    static const FTPCommand *findCommand(quint32 verb);
+    static bool isCommandEnabled(const FTPCommand &command);
 
     // FTP commands (RFC959)
 
@@ -129,6 +148,7 @@ private:
     // Extended FTP commands (RFC3659, RFC2389)
 
     static void FEAT(CogWheelControlChannel *connection, const QString &arguments);
+    static void OPTS(CogWheelControlChannel *connection, const QString &arguments);
     static void MDTM(CogWheelControlChannel *connection, const QString &arguments);
     static void SIZE(CogWheelControlChannel *connection, const QString &arguments);
     static void AUTH(CogWheelControlChannel *connection, const QString &arguments);
@@ -137,14 +157,15 @@ private:
     static void MLSD(CogWheelControlChannel *connection, const QString &arguments);
     static void MLST(CogWheelControlChannel *connection, const QString &arguments);
 
-private:
+    // SITE commands
+
+    static void MLSDR(CogWheelControlChannel *connection, const QString &arguments);
 
-    static QHash<QString, FTPCommandFunction> m_unauthCommandTable;       // Unauthorised user command table
-    static QHash<QString, FTPCommandFunction> m_ftpCommandTable;          // Authorised user command table
-    static QHash<QString, FTPCommandFunction> m_ftpCommandTableExtended;  // Extended command table
+private:
 
     static QHash<quint16, QString> m_ftpServerResponse;   // Server response code table
-    static QHash<QString,QString> m_featTailoredRespone;  // Tailored FEAT command responses
+    static QHash<quint16, QByteArray> m_ftpServerResponseBytes;  // Server response wire bytes
+    static QHash<quint32,QString> m_featTailoredRespone;  // Tailored FEAT command responses
 
     static CogWheelServerSettings m_serverSettings;       // FTP server settinngs
 
@@ -24,86 +24,350 @@
 
 #include "cogwheelftpcoreutil.h"
 #include "cogwheellogger.h"
+#include "cogwheelidnamecache.h"
+
+#include <cstring>
+#include <ctime>
 
 namespace CogWheelFTPCoreUtil {
 
+// Local time fields of a file timestamp
+
+struct LocalTime {
+    int year;
+    int month;          // 1 - 12
+    int day;
+    int hour;
+    int minute;
+    int second;
+};
+
+// LIST month names (as 'ls -l' in the C locale)
+
+static const char kMonthNames[12][4] { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                       "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+// rwx permission triplets indexed by three permission bits
+
+static const char kPermissionTriplets[8][4] { "---", "--x", "-w-", "-wx", "r--", "r-x", "rw-", "rwx" };
+
+// MLST/MLSD fact names (in fact list order)
+
+struct MLSTFactName {
+    const char *name;
+    quint32 fact;
+};
+
+static const MLSTFactName kMLSTFactNames[] { { "Type", kCWFactType }, { "Size", kCWFactSize },
+                                             { "Modify", kCWFactModify }, { "Create", kCWFactCreate },
+                                             { "UNIX.mode", kCWFactUnixMode }, { "UNIX.owner", kCWFactUnixOwner },
+                                             { "UNIX.group", kCWFactUnixGroup }, { "UNIX.ownername", kCWFactUnixOwnerName },
+                                             { "UNIX.groupname", kCWFactUnixGroupName } };
+
+// Bytes for the fixed fields of a LIST line/fact list (names are extra)
+
+constexpr const int kLISTLineFixedSize=96;
+constexpr const int kFactListFixedSize=192;
+
+/**
+ * @brief toLocalTime
+ *
+ * Convert a file timestamp to local time fields.
+ *
+ * @param msecsSinceEpoch   Timestamp (msecs since epoch).
+ * @param localTime         Returned local time fields.
+ */
+static void toLocalTime(qint64 msecsSinceEpoch, LocalTime &localTime)
+{
+
+#ifdef Q_OS_UNIX
+
+    time_t seconds = static_cast<time_t>(msecsSinceEpoch/1000);
+    struct tm brokenDownTime;
+
+    ::localtime_r(&seconds, &brokenDownTime);
+
+    localTime.year = brokenDownTime.tm_year+1900;
+    localTime.month = brokenDownTime.tm_mon+1;
+    localTime.day = brokenDownTime.tm_mday;
+    localTime.hour = brokenDownTime.tm_hour;
+    localTime.minute = brokenDownTime.tm_min;
+    localTime.second = brokenDownTime.tm_sec;
+
+#else
+
+    QDateTime dateTime { QDateTime::fromMSecsSinceEpoch(msecsSinceEpoch) };
+
+    localTime.year = dateTime.date().year();
+    localTime.month = dateTime.date().month();
+    localTime.day = dateTime.date().day();
+    localTime.hour = dateTime.time().hour();
+    localTime.minute = dateTime.time().minute();
+    localTime.second = dateTime.time().second();
+
+#endif
+
+}
+
+/**
+ * @brief appendText
+ *
+ * @param output    Output position.
+ * @param text      Text to write.
+ * @param length    Text length.
+ *
+ * @return  Output position after text.
+ */
+static inline char *appendText(char *output, const char *text, int length)
+{
+    std::memcpy(output, text, static_cast<size_t>(length));
+    return(output+length);
+}
+
+/**
+ * @brief appendDigits
+ *
+ * Write a number as a fixed number of decimal digits (zero filled).
+ *
+ * @param output    Output position.
+ * @param value     Value to write.
+ * @param digits    Number of digits.
+ *
+ * @return  Output position after number.
+ */
+static inline char *appendDigits(char *output, int value, int digits)
+{
+    for (int digit=digits-1; digit >= 0; digit--) {
+        output[digit] = static_cast<char>('0'+(value%10));
+        value /= 10;
+    }
+    return(output+digits);
+}
+
+/**
+ * @brief appendNumber
+ *
+ * Write an unsigned number in a given base right justified to a minimum width.
+ *
+ * @param output    Output position.
+ * @param value     Value to write.
+ * @param width     Minimum width (space padded).
+ * @param base      Number base (8 or 10).
+ *
+ * @return  Output position after number.
+ */
+static inline char *appendNumber(char *output, quint64 value, int width=0, unsigned base=10)
+{
+
+    char digits[24];
+    int digitCount=0;
+
+    do {
+        digits[digitCount++] = static_cast<char>('0'+(value%base));
+        value /= base;
+    } while (value);
+
+    while (width-- > digitCount) {
+        *output++ = ' ';
+    }
+
+    while (digitCount) {
+        *output++ = digits[--digitCount];
+    }
+
+    return(output);
+
+}
+
 /**
- * @brief buildFilePermissions
+ * @brief appendJustifiedName
  *
- * Build files permissions (for LIST) into QString and return.
+ * Write UTF-8 name left justified and truncated to width characters ("0"
+ * if name is empty).
  *
- * @param fileInfo  File to produce permissions for.
+ * @param output    Output position.
+ * @param name      UTF-8 name.
+ * @param width     Field width in characters.
  *
- * @return Files permissions as a QString.
+ * @return  Output position after field.
  */
-static QString buildFilePermissions(const QFileInfo &fileInfo)
+static inline char *appendJustifiedName(char *output, const QByteArray &name, int width)
 {
 
-    char permissions[10];
+    const char *nameBytes = name.isEmpty() ? "0" : name.constData();
+    int characters=0;
+
+    for (; *nameBytes; nameBytes++) {
+        if ((*nameBytes & 0xC0) != 0x80) {
+            if (characters == width) {
+                break;
+            }
+            characters++;
+        }
+        *output++ = *nameBytes;
+    }
 
-    permissions[0] = (fileInfo.permissions() & QFile::ReadUser) ? 'r' : '-';
-    permissions[1] = (fileInfo.permissions() & QFile::WriteUser) ? 'w' : '-';
-    permissions[2] = (fileInfo.permissions() & QFile::ExeUser) ? 'x' : '-';
-    permissions[3] = (fileInfo.permissions() & QFile::ReadGroup) ? 'r' : '-';
-    permissions[4] = (fileInfo.permissions() & QFile::WriteGroup) ? 'w' : '-';
-    permissions[5] = (fileInfo.permissions() & QFile::ExeGroup) ? 'x' : '-';
-    permissions[6] = (fileInfo.permissions() & QFile::ReadOther) ? 'r' : '-';
-    permissions[7] = (fileInfo.permissions() & QFile::WriteOther) ? 'w' : '-';
-    permissions[8] = (fileInfo.permissions() & QFile::ExeOther) ? 'x' : '-';
-    permissions[9] = 0;
+    while (characters++ < width) {
+        *output++ = ' ';
+    }
 
-    return(permissions);
+    return(output);
 
 }
 
 /**
- * @brief buildUnixModePermissions
+ * @brief appendFilePermissions
+ *
+ * Write files permissions (for LIST).
+ *
+ * @param output    Output position.
+ * @param fileStat  File to produce permissions for.
+ *
+ * @return  Output position after permissions.
+ */
+static inline char *appendFilePermissions(char *output, const CogWheelFileStat &fileStat)
+{
+    output = appendText(output, kPermissionTriplets[(fileStat.permissions >> 6) & 7], 3);
+    output = appendText(output, kPermissionTriplets[(fileStat.permissions >> 3) & 7], 3);
+    return(appendText(output, kPermissionTriplets[fileStat.permissions & 7], 3));
+}
+
+/**
+ * @brief appendFactTime
  *
- * Build files unix permissions into octal QString and return.
+ * Write fact timestamp (yyyyMMddhhmmss).
  *
- * @param fileInfo  File to produce permissions for.
+ * @param output            Output position.
+ * @param msecsSinceEpoch   Timestamp (msecs since epoch).
  *
- * @return Files permissions as a octal QString.
+ * @return  Output position after timestamp.
  */
-static QString buildUnixModePermissions(const QFileInfo &fileInfo)
+static inline char *appendFactTime(char *output, qint64 msecsSinceEpoch)
 {
 
-   unsigned short permissions=0;
+    LocalTime localTime;
 
-   permissions |= (fileInfo.permissions() & QFile::ReadUser) ? 0400 : 0;
-   permissions |= (fileInfo.permissions() & QFile::WriteUser) ? 0200 : 0;
-   permissions |= (fileInfo.permissions() & QFile::ExeUser) ? 0100 : 0;
-   permissions |= (fileInfo.permissions() & QFile::ReadGroup) ? 0040 : 0;
-   permissions |= (fileInfo.permissions() & QFile::WriteGroup) ? 0020 : 0;
-   permissions |= (fileInfo.permissions() & QFile::ExeGroup) ? 0010 : 0;
-   permissions |= (fileInfo.permissions() & QFile::ReadOther) ? 0004 : 0;
-   permissions |= (fileInfo.permissions() & QFile::WriteOther) ? 0002 : 0;
-   permissions |= (fileInfo.permissions() & QFile::ExeOther) ? 0001 : 0;
+    toLocalTime(msecsSinceEpoch, localTime);
 
-   return("0"+QString::number(permissions,8));
+    output = appendDigits(output, localTime.year, 4);
+    output = appendDigits(output, localTime.month, 2);
+    output = appendDigits(output, localTime.day, 2);
+    output = appendDigits(output, localTime.hour, 2);
+    output = appendDigits(output, localTime.minute, 2);
+    return(appendDigits(output, localTime.second, 2));
 
 }
 
 /**
-* @brief buildFileCommonFactList
+* @brief appendFileCommonFactList
 *
-* Build a list of common facts for file information passed in.
+* Write the selected common facts for file information passed in.
 *
-* @param fileInfo  File to produce facts for.
+* @param output     Output position.
+* @param fileStat   File to produce facts for.
+* @param facts      Facts selected.
+* @param ownerName  File owner name (UTF-8).
+* @param groupName  File group name (UTF-8).
 *
-* @return Common file facts.
+* @return Output position after facts.
 */
-static QString buildFileCommonFactList(const QFileInfo &fileInfo)
+static char *appendFileCommonFactList(char *output, const CogWheelFileStat &fileStat, quint32 facts,
+                                      const QByteArray &ownerName, const QByteArray &groupName)
+{
+
+   if (facts & kCWFactModify) {
+       output = appendText(output, "Modify=", 7);
+       output = appendFactTime(output, fileStat.modifyTime);
+       output = appendText(output, ";", 1);
+   }
+   if (facts & kCWFactCreate) {
+       output = appendText(output, "Create=", 7);
+       output = appendFactTime(output, fileStat.createTime);
+       output = appendText(output, ";", 1);
+   }
+   if (facts & kCWFactUnixMode) {
+       output = appendText(output, "UNIX.mode=0", 11);
+       output = appendNumber(output, fileStat.permissions & 0777, 0, 8);
+       output = appendText(output, ";", 1);
+   }
+   if (facts & kCWFactUnixOwner) {
+       output = appendText(output, "UNIX.owner=", 11);
+       output = appendNumber(output, fileStat.ownerId);
+       output = appendText(output, ";", 1);
+   }
+   if (facts & kCWFactUnixGroup) {
+       output = appendText(output, "UNIX.group=", 11);
+       output = appendNumber(output, fileStat.groupId);
+       output = appendText(output, ";", 1);
+   }
+   if (facts & kCWFactUnixOwnerName) {
+       output = appendText(output, "UNIX.ownername=", 15);
+       output = appendText(output, ownerName.constData(), ownerName.size());
+       output = appendText(output, ";", 1);
+   }
+   if (facts & kCWFactUnixGroupName) {
+       output = appendText(output, "UNIX.groupname=", 15);
+       output = appendText(output, groupName.constData(), groupName.size());
+       output = appendText(output, ";", 1);
+   }
+
+   return(output);
+
+}
+
+/**
+ * @brief appendFactList
+ *
+ * Append fact list of the selected facts for file metadata to buffer; owner
+ * and group names are only looked up if their facts are selected.
+ *
+ * @param buffer    Buffer to append to.
+ * @param fileStat  File metadata to produce fact list for.
+ * @param facts     Facts selected.
+ * @param name      Name to follow facts (UTF-8).
+ * @param isPath    == true fact list for listed directory (cdir).
+ */
+static void appendFactList(QByteArray &buffer, const CogWheelFileStat &fileStat, quint32 facts,
+                           const QByteArray &name, bool isPath)
 {
-   QString factList;
 
-   factList.append(static_cast<QString>("Modify=")+fileInfo.lastModified().toString("yyyyMMddhhmmss;"));
-   factList.append(static_cast<QString>("Create=")+fileInfo.created().toString("yyyyMMddhhmmss;"));
-   factList.append(static_cast<QString>("UNIX.mode=")+buildUnixModePermissions(fileInfo)+";");
-   factList.append(static_cast<QString>("UNIX.owner=")+QString::number(fileInfo.ownerId())+";");
-   factList.append(static_cast<QString>("UNIX.group=")+QString::number(fileInfo.groupId())+";");
+    QByteArray ownerName;
+    QByteArray groupName;
+    int bufferSize = buffer.size();
+
+    if (facts & kCWFactUnixOwnerName) {
+        ownerName = CogWheelIdNameCache::getInstance().encodedUserName(fileStat.ownerId);
+    }
+    if (facts & kCWFactUnixGroupName) {
+        groupName = CogWheelIdNameCache::getInstance().encodedGroupName(fileStat.groupId);
+    }
+
+    buffer.resize(bufferSize+kFactListFixedSize+ownerName.size()+groupName.size()+name.size());
+
+    char *bufferStart = buffer.data();
+    char *output = bufferStart+bufferSize;
+
+    if (facts & kCWFactType) {
+        if (isPath) {
+            output = appendText(output, "Type=cdir;", 10);
+        } else if (fileStat.isDir) {
+            output = appendText(output, "Type=dir;", 9);
+        } else {
+            output = appendText(output, "Type=file;", 10);
+        }
+    }
+
+    if ((facts & kCWFactSize) && !isPath && !fileStat.isDir) {
+        output = appendText(output, "Size=", 5);
+        output = appendNumber(output, fileStat.size);
+        output = appendText(output, ";", 1);
+    }
+
+    output = appendFileCommonFactList(output, fileStat, facts, ownerName, groupName);
+    output = appendText(output, " ", 1);
+    output = appendText(output, name.constData(), name.size());
 
-   return factList;
+    buffer.resize(static_cast<int>(output-bufferStart));
 
 }
 
@@ -175,48 +439,99 @@ QString mapPathFromLocal(CogWheelControlChannel *connection, const QString &path
     return(mappedPath);
 }
 
+/**
+ * @brief appendLISTLine
+ *
+ * Append list line for passed in file metadata to buffer (UTF-8). The
+ * format of which is the same as given for the Linux 'ls -l' command.
+ * Fields are written straight into the buffer with no intermediate
+ * strings.
+ *
+ * @param buffer    Buffer to append to.
+ * @param fileStat  File to produce list line for.
+ */
+void appendLISTLine(QByteArray &buffer, const CogWheelFileStat &fileStat)
+{
+
+    QByteArray ownerName { CogWheelIdNameCache::getInstance().encodedUserName(fileStat.ownerId) };
+    QByteArray groupName { CogWheelIdNameCache::getInstance().encodedGroupName(fileStat.groupId) };
+    LocalTime modifyTime;
+    int bufferSize = buffer.size();
+
+    toLocalTime(fileStat.modifyTime, modifyTime);
+
+    buffer.resize(bufferSize+kLISTLineFixedSize+ownerName.size()+groupName.size()+fileStat.fileName.size());
+
+    char *bufferStart = buffer.data();
+    char *line = bufferStart+bufferSize;
+
+    if (fileStat.isSymLink) {
+        *line++ = 'l';
+    } else if (fileStat.isDir){
+        *line++ = 'd';
+    } else {
+        *line++ = '-';
+    }
+
+    line = appendFilePermissions(line, fileStat);
+    line = appendText(line, " 1 ", 3);
+    line = appendJustifiedName(line, ownerName, 10);
+    line = appendText(line, " ", 1);
+    line = appendJustifiedName(line, groupName, 10);
+    line = appendText(line, " ", 1);
+    line = appendNumber(line, fileStat.size, 10);
+    line = appendText(line, " ", 1);
+    line = appendText(line, kMonthNames[(modifyTime.month-1) % 12], 3);
+    line = appendText(line, " ", 1);
+    line = appendDigits(line, modifyTime.day, 2);
+    line = appendText(line, " ", 1);
+    line = appendDigits(line, modifyTime.hour, 2);
+    line = appendText(line, ":", 1);
+    line = appendDigits(line, modifyTime.minute, 2);
+    line = appendText(line, " ", 1);
+    line = appendText(line, fileStat.fileName.constData(), fileStat.fileName.size());
+
+    buffer.resize(static_cast<int>(line-bufferStart));
+
+}
+
 /**
  * @brief buildLISTLine
  *
- * Build list line for passed in QFileInfo. The format of which
- * is the same as given for the Linux 'ls -l' command.
+ * Build list line for passed in file metadata.
  *
- * @param fileInfo  File to produce list line for.
+ * @param fileStat  File to produce list line for.
  *
  * @return List line QString.
  */
-QString buildLISTLine(const QFileInfo &fileInfo)
+QString buildLISTLine(const CogWheelFileStat &fileStat)
 {
 
-    QChar   fileType= '-';
-    QString line;
-    QString ownerGroup;
+    QByteArray line;
 
-    if (fileInfo.isSymLink()) {
-        fileType = 'l';
-    } else if (fileInfo.isDir()){
-        fileType = 'd';
-    }
+    appendLISTLine(line, fileStat);
 
-    line.append(fileType+buildFilePermissions(fileInfo)+" 1 ");
+    return(QString::fromUtf8(line));
 
-    ownerGroup = fileInfo.owner();
-    if(ownerGroup.isEmpty()) {
-        ownerGroup = "0";
-    }
-    line.append(ownerGroup.leftJustified(10,' ',true)+" ");
+}
 
-    ownerGroup = fileInfo.group();
-    if(ownerGroup.isEmpty()) {
-        ownerGroup = "0";
-    }
-    line.append(ownerGroup.leftJustified(10,' ',true)+" ");
+/**
+ * @brief buildLISTLine
+ *
+ * Build list line for passed in QFileInfo.
+ *
+ * @param fileInfo  File to produce list line for.
+ *
+ * @return List line QString.
+ */
+QString buildLISTLine(const QFileInfo &fileInfo)
+{
+
+    CogWheelFileStat fileStat;
 
-    line.append(QString::number(fileInfo.size()).rightJustified(10,' ',true)+" ");
-    line.append(fileInfo.lastModified().toString("MMM dd hh:mm").rightJustified(12,' ',true)+" ");
-    line.append(fileInfo.fileName());
+    CogWheelDirectoryScanner::statFile(fileInfo, fileStat);
 
-    return(line);
+    return(buildLISTLine(fileStat));
 
 }
 
@@ -227,12 +542,72 @@ QString buildLISTLine(const QFileInfo &fileInfo)
  *
  * @param pathInfo  Path information to produce fact list for.
  * @param path      Directory path.
+ * @param facts     Facts selected.
  *
  * @return Fact list for path.
  */
-QString buildPathFactList(const QFileInfo &pathInfo, const QString &path)
+QString buildPathFactList(const QFileInfo &pathInfo, const QString &path, quint32 facts)
+{
+
+    CogWheelFileStat pathStat;
+    QByteArray factList;
+
+    CogWheelDirectoryScanner::statFile(pathInfo, pathStat);
+
+    appendFactList(factList, pathStat, facts, path.toUtf8(), true);
+
+    return(QString::fromUtf8(factList));
+
+}
+
+/**
+ * @brief appendPathFactList
+ *
+ * Append fact list for a listed directory (cdir) to buffer (UTF-8).
+ *
+ * @param buffer    Buffer to append to.
+ * @param pathStat  Directory metadata.
+ * @param path      Directory path (UTF-8).
+ * @param facts     Facts selected.
+ */
+void appendPathFactList(QByteArray &buffer, const CogWheelFileStat &pathStat, const QByteArray &path, quint32 facts)
 {
-    return (static_cast<QString>("Type=cdir;")+buildFileCommonFactList(pathInfo)+" "+path);
+    appendFactList(buffer, pathStat, facts, path, true);
+}
+
+/**
+ * @brief appendFileFactList
+ *
+ * Append fact list for file metadata passed in to buffer (UTF-8).
+ *
+ * @param buffer    Buffer to append to.
+ * @param fileStat  File metadata to produce fact list for.
+ * @param facts     Facts selected.
+ */
+void appendFileFactList(QByteArray &buffer, const CogWheelFileStat &fileStat, quint32 facts)
+{
+    appendFactList(buffer, fileStat, facts, fileStat.fileName, false);
+}
+
+/**
+ * @brief buildFileFactList
+ *
+ * Build fact list for file metadata passed in.
+ *
+ * @param fileStat  File metadata to produce fact list for.
+ * @param facts     Facts selected.
+ *
+ * @return Fact list for file.
+ */
+QString buildFileFactList(const CogWheelFileStat &fileStat, quint32 facts)
+{
+
+    QByteArray factList;
+
+    appendFileFactList(factList, fileStat, facts);
+
+    return(QString::fromUtf8(factList));
+
 }
 
 /**
@@ -241,23 +616,80 @@ QString buildPathFactList(const QFileInfo &pathInfo, const QString &path)
  * Build fact list for file information passed in.
  *
  * @param fileInfo  File information to produce fact list for.
+ * @param facts     Facts selected.
  *
  * @return Fact list for file.
  */
-QString buildFileFactList(const QFileInfo &fileInfo)
+QString buildFileFactList(const QFileInfo &fileInfo, quint32 facts)
+{
+
+    CogWheelFileStat fileStat;
+
+    CogWheelDirectoryScanner::statFile(fileInfo, fileStat);
+
+    return(buildFileFactList(fileStat, facts));
+
+}
+
+/**
+ * @brief parseMLSTFacts
+ *
+ * Parse OPTS MLST fact list (case insensitive, ';' terminated). Facts
+ * not supported are ignored.
+ *
+ * @param factList  Fact names.
+ *
+ * @return  Facts selected.
+ */
+quint32 parseMLSTFacts(const QString &factList)
 {
 
-    QString factList;
+    quint32 facts=0;
 
-    if(fileInfo.isDir()){
-        factList.append("Type=dir;");
-    }else {
-        factList.append((static_cast<QString>("Type=file;")+"Size=")+QString::number(fileInfo.size())+";");
+    for (const QString &factName : factList.split(';', QString::SkipEmptyParts)) {
+        for (const MLSTFactName &fact : kMLSTFactNames) {
+            if (factName.compare(fact.name, Qt::CaseInsensitive)==0) {
+                facts |= fact.fact;
+                break;
+            }
+        }
     }
 
-    factList.append(buildFileCommonFactList(fileInfo)+" "+fileInfo.fileName());
+    return(facts);
+
+}
+
+/**
+ * @brief buildMLSTFactNames
+ *
+ * Build a list of fact names (each ';' terminated). For FEAT all supported
+ * facts are listed with those currently selected marked by a '*'; otherwise
+ * only the selected facts are listed (OPTS MLST reply).
+ *
+ * @param facts         Facts selected.
+ * @param allFacts      == true list all supported facts (FEAT).
+ *
+ * @return  Fact name list.
+ */
+QString buildMLSTFactNames(quint32 facts, bool allFacts)
+{
+
+    QString factNames;
+
+    for (const MLSTFactName &fact : kMLSTFactNames) {
+        if (facts & fact.fact) {
+            factNames.append(fact.name);
+            if (allFacts) {
+                factNames.append('*');
+            }
+            factNames.append(';');
+        } else if (allFacts) {
+            factNames.append(fact.name);
+            factNames.append(';');
+        }
+    }
 
-    return factList;
+    return(factNames);
 
 }
 
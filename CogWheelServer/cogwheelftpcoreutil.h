@@ -26,6 +26,7 @@
 
 #include "cogwheel.h"
 #include "cogwheelcontrolchannel.h"
+#include "cogwheeldirectoryscanner.h"
 
 #include <QDir>
 #include <QDateTime>
@@ -40,18 +41,32 @@ QString mapPathToLocal(CogWheelControlChannel *connection, const QString &path);
 
 QString mapPathFromLocal(CogWheelControlChannel *connection, const QString &path);
 
-// Build list line for passed in QFileInfo. The format of which
-// is the same as given for the Linux 'ls -l' command.
+// Build list line for passed in file metadata/QFileInfo. The format
+// of which is the same as given for the Linux 'ls -l' command.
 
+void appendLISTLine(QByteArray &buffer, const CogWheelFileStat &fileStat);
+QString buildLISTLine(const CogWheelFileStat &fileStat);
 QString buildLISTLine(const QFileInfo &fileInfo);
 
 // Build fact list for passed in path (directory).
 
-QString buildPathFactList(const QFileInfo &pathInfo, const QString &path);
+void appendPathFactList(QByteArray &buffer, const CogWheelFileStat &pathStat, const QByteArray &path, quint32 facts=kCWFactAll);
+QString buildPathFactList(const QFileInfo &pathInfo, const QString &path, quint32 facts=kCWFactAll);
 
-// Build fact list for file information passed in.
+// Build fact list for file metadata/information passed in.
 
-QString buildFileFactList(const QFileInfo &fileInfo);
+void appendFileFactList(QByteArray &buffer, const CogWheelFileStat &fileStat, quint32 facts=kCWFactAll);
+QString buildFileFactList(const CogWheelFileStat &fileStat, quint32 facts=kCWFactAll);
+QString buildFileFactList(const QFileInfo &fileInfo, quint32 facts=kCWFactAll);
+
+// Parse OPTS MLST fact list into facts selected.
+
+quint32 parseMLSTFacts(const QString &factList);
+
+// Build fact name list for FEAT (all facts, selected marked '*')
+// or OPTS MLST reply (selected facts only).
+
+QString buildMLSTFactNames(quint32 facts, bool allFacts);
 
 } // namespace CogWheelFTPCoreUtil
 
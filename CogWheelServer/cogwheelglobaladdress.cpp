@@ -0,0 +1,182 @@
+/*
+ * File:   cogwheelglobaladdress.cpp
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+//
+// Class: CogWheelGlobalAddress
+//
+// Description: Class to resolve the server global name (the address of the server
+// outside of any NAT) and cache it for all connections. The name is resolved once at
+// startup and then refreshed asynchronously on a timer so that any DDNS change is
+// picked up without a blocking lookup per connection.
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheelglobaladdress.h"
+#include "cogwheellogger.h"
+
+// ====================
+// CLASS IMPLEMENTATION
+// ====================
+
+// Cached global address and its lock
+
+QReadWriteLock CogWheelGlobalAddress::m_addressLock;
+QString CogWheelGlobalAddress::m_address;
+
+/**
+ * @brief CogWheelGlobalAddress::CogWheelGlobalAddress
+ *
+ * Setup refresh timer.
+ *
+ * @param parent    Parent object.
+ */
+CogWheelGlobalAddress::CogWheelGlobalAddress(QObject *parent) : QObject(parent)
+{
+    connect(&m_refreshTimer, &QTimer::timeout, this, &CogWheelGlobalAddress::refresh);
+}
+
+/**
+ * @brief CogWheelGlobalAddress::~CogWheelGlobalAddress
+ *
+ * Destructor. Stop any refresh.
+ *
+ */
+CogWheelGlobalAddress::~CogWheelGlobalAddress()
+{
+    stop();
+}
+
+/**
+ * @brief CogWheelGlobalAddress::start
+ *
+ * Resolve global name now and then refresh it every refreshSeconds
+ * (0 == never). An empty name clears the cached address.
+ *
+ * @param globalName        Server global name.
+ * @param refreshSeconds    Refresh period in seconds.
+ */
+void CogWheelGlobalAddress::start(const QString &globalName, int refreshSeconds)
+{
+
+    stop();
+
+    m_globalName = globalName;
+
+    if (m_globalName.isEmpty()) {
+        QWriteLocker addressLock { &m_addressLock };
+        m_address.clear();
+        return;
+    }
+
+    // Initial blocking lookup so first connections have an address
+
+    updateAddress(QHostInfo::fromName(m_globalName));
+
+    if (refreshSeconds > 0) {
+        m_refreshTimer.start(refreshSeconds*1000);
+    }
+
+}
+
+/**
+ * @brief CogWheelGlobalAddress::stop
+ *
+ * Stop refresh timer and abort any lookup in progress.
+ *
+ */
+void CogWheelGlobalAddress::stop()
+{
+
+    m_refreshTimer.stop();
+
+    if (m_lookupId != -1) {
+        QHostInfo::abortHostLookup(m_lookupId);
+        m_lookupId = -1;
+    }
+
+}
+
+/**
+ * @brief CogWheelGlobalAddress::address
+ *
+ * @return  Cached global address (empty if none).
+ */
+QString CogWheelGlobalAddress::address()
+{
+    QReadLocker addressLock { &m_addressLock };
+    return(m_address);
+}
+
+/**
+ * @brief CogWheelGlobalAddress::updateAddress
+ *
+ * Update cached address with the first IPv4 address from a lookup. If the
+ * lookup failed the previous address is kept.
+ *
+ * @param hostInfo  Host lookup result.
+ */
+void CogWheelGlobalAddress::updateAddress(const QHostInfo &hostInfo)
+{
+
+    if ((hostInfo.error() != QHostInfo::NoError) || hostInfo.addresses().isEmpty()) {
+        cogWheelWarning("Could not resolve server global name ["+m_globalName+"]: "+hostInfo.errorString());
+        return;
+    }
+
+    QHostAddress globalAddress { hostInfo.addresses().first().toIPv4Address() };
+
+    for (const QHostAddress &address : hostInfo.addresses()) {
+        if (address.protocol() == QAbstractSocket::IPv4Protocol) {
+            globalAddress = address;
+            break;
+        }
+    }
+
+    QWriteLocker addressLock { &m_addressLock };
+
+    if (m_address != globalAddress.toString()) {
+        m_address = globalAddress.toString();
+        cogWheelInfo("Server global name ["+m_globalName+"] resolved to "+m_address);
+    }
+
+}
+
+/**
+ * @brief CogWheelGlobalAddress::refresh
+ *
+ * Refresh timer slot function. Start an asynchronous lookup of the
+ * global name if one is not already in progress.
+ *
+ */
+void CogWheelGlobalAddress::refresh()
+{
+
+    if (m_lookupId == -1) {
+        m_lookupId = QHostInfo::lookupHost(m_globalName, this, SLOT(lookedUp(QHostInfo)));
+    }
+
+}
+
+/**
+ * @brief CogWheelGlobalAddress::lookedUp
+ *
+ * Asynchronous lookup complete slot function.
+ *
+ * @param hostInfo  Host lookup result.
+ */
+void CogWheelGlobalAddress::lookedUp(const QHostInfo &hostInfo)
+{
+    m_lookupId = -1;
+    updateAddress(hostInfo);
+}
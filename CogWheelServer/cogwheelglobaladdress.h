@@ -0,0 +1,91 @@
+/*
+ * File:   cogwheelglobaladdress.h
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+#ifndef COGWHEELGLOBALADDRESS_H
+#define COGWHEELGLOBALADDRESS_H
+
+//
+// Class: CogWheelGlobalAddress
+//
+// Description: Class to resolve the server global name (the address of the server
+// outside of any NAT) and cache it for all connections. The name is resolved once at
+// startup and then refreshed asynchronously on a timer so that any DDNS change is
+// picked up without a blocking lookup per connection.
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheel.h"
+
+#include <QObject>
+#include <QTimer>
+#include <QHostInfo>
+#include <QReadWriteLock>
+
+// =================
+// CLASS DECLARATION
+// =================
+
+class CogWheelGlobalAddress : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    // Class exception
+
+    struct Exception : public std::runtime_error {
+
+        Exception(const QString & messageStr)
+            : std::runtime_error(static_cast<QString>("CogWheelGlobalAddress Failure: " + messageStr).toStdString()) {
+        }
+
+    };
+
+    // Constructor / Destructor
+
+    explicit CogWheelGlobalAddress(QObject *parent = nullptr);
+    ~CogWheelGlobalAddress();
+
+    // Start/stop resolving global name
+
+    void start(const QString &globalName, int refreshSeconds);
+    void stop();
+
+    // Cached global address (empty if none)
+
+    static QString address();
+
+private:
+
+    // Update cached address from lookup
+
+    void updateAddress(const QHostInfo &hostInfo);
+
+private slots:
+
+    void refresh();                             // Start asynchronous lookup
+    void lookedUp(const QHostInfo &hostInfo);   // Lookup complete
+
+private:
+
+    QString m_globalName;                   // Server global name
+    QTimer m_refreshTimer;                  // Address refresh timer
+    int m_lookupId=-1;                      // Current lookup (-1 == none)
+
+    static QReadWriteLock m_addressLock;    // Cached address lock
+    static QString m_address;               // Cached global address
+
+};
+
+#endif // COGWHEELGLOBALADDRESS_H
@@ -0,0 +1,168 @@
+/*
+ * File:   cogwheelidnamecache.cpp
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+//
+// Class: CogWheelIdNameCache
+//
+// Description: Singleton class to cache user id to user name and group id to
+// group name lookups for listings. Each getpwuid/getgrgid can go out to NSS (LDAP
+// etc.) so names are kept for a time to live before being looked up again. It is
+// shared by all connection threads and guarded by a read/write lock.
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheelidnamecache.h"
+
+#include <QDateTime>
+#include <QVarLengthArray>
+
+#ifdef Q_OS_UNIX
+#include <pwd.h>
+#include <grp.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// ====================
+// CLASS IMPLEMENTATION
+// ====================
+
+/**
+ * @brief CogWheelIdNameCache::userName
+ *
+ * @param userId    User id.
+ *
+ * @return  User name (empty if none).
+ */
+QString CogWheelIdNameCache::userName(uint userId)
+{
+    return(findName(m_userNames, userId, false).name);
+}
+
+/**
+ * @brief CogWheelIdNameCache::groupName
+ *
+ * @param groupId   Group id.
+ *
+ * @return  Group name (empty if none).
+ */
+QString CogWheelIdNameCache::groupName(uint groupId)
+{
+    return(findName(m_groupNames, groupId, true).name);
+}
+
+/**
+ * @brief CogWheelIdNameCache::encodedUserName
+ *
+ * @param userId    User id.
+ *
+ * @return  User name as UTF-8 (empty if none).
+ */
+QByteArray CogWheelIdNameCache::encodedUserName(uint userId)
+{
+    return(findName(m_userNames, userId, false).encodedName);
+}
+
+/**
+ * @brief CogWheelIdNameCache::encodedGroupName
+ *
+ * @param groupId   Group id.
+ *
+ * @return  Group name as UTF-8 (empty if none).
+ */
+QByteArray CogWheelIdNameCache::encodedGroupName(uint groupId)
+{
+    return(findName(m_groupNames, groupId, true).encodedName);
+}
+
+/**
+ * @brief CogWheelIdNameCache::findName
+ *
+ * Return name for id from cache if it has not expired otherwise look it
+ * up (with the re-entrant getpwuid_r/getgrgid_r) and cache the result;
+ * ids with no name are cached too so they are not looked up every time.
+ *
+ * @param names     User or group name cache.
+ * @param id        User or group id.
+ * @param isGroup   == true id is a group id.
+ *
+ * @return  Cached name (empty if none).
+ */
+CogWheelIdNameCache::CachedName CogWheelIdNameCache::findName(QHash<uint, CachedName> &names, uint id, bool isGroup)
+{
+
+    qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
+
+    {
+        QReadLocker cacheLock { &m_cacheLock };
+
+        auto cachedName = names.constFind(id);
+
+        if ((cachedName != names.constEnd()) && (cachedName->expires > currentTime)) {
+            return(*cachedName);
+        }
+    }
+
+    // Lookup outside of lock (may be slow)
+
+    CachedName newName;
+
+#ifdef Q_OS_UNIX
+
+    long bufferSize = ::sysconf(isGroup ? _SC_GETGR_R_SIZE_MAX : _SC_GETPW_R_SIZE_MAX);
+
+    QVarLengthArray<char, 1024> buffer((bufferSize > 0) ? static_cast<int>(bufferSize) : 1024);
+
+    for (;;) {
+
+        int result;
+
+        if (isGroup) {
+            struct group groupEntry, *groupResult=nullptr;
+            result = ::getgrgid_r(static_cast<gid_t>(id), &groupEntry, buffer.data(), static_cast<size_t>(buffer.size()), &groupResult);
+            if ((result==0) && groupResult) {
+                newName.name = QString::fromLocal8Bit(groupResult->gr_name);
+            }
+        } else {
+            struct passwd passwdEntry, *passwdResult=nullptr;
+            result = ::getpwuid_r(static_cast<uid_t>(id), &passwdEntry, buffer.data(), static_cast<size_t>(buffer.size()), &passwdResult);
+            if ((result==0) && passwdResult) {
+                newName.name = QString::fromLocal8Bit(passwdResult->pw_name);
+            }
+        }
+
+        if ((result!=ERANGE) || (buffer.size() >= 1024*1024)) {
+            break;
+        }
+
+        buffer.resize(buffer.size()*2);
+
+    }
+
+#else
+
+    Q_UNUSED(isGroup);
+
+#endif
+
+    newName.encodedName = newName.name.toUtf8();
+    newName.expires = currentTime+(kCWIdNameCacheTTL*1000);
+
+    QWriteLocker cacheLock { &m_cacheLock };
+
+    names.insert(id, newName);
+
+    return(newName);
+
+}
@@ -0,0 +1,102 @@
+/*
+ * File:   cogwheelidnamecache.h
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+#ifndef COGWHEELIDNAMECACHE_H
+#define COGWHEELIDNAMECACHE_H
+
+//
+// Class: CogWheelIdNameCache
+//
+// Description: Singleton class to cache user id to user name and group id to
+// group name lookups for listings. Each getpwuid/getgrgid can go out to NSS (LDAP
+// etc.) so names are kept for a time to live before being looked up again. It is
+// shared by all connection threads and guarded by a read/write lock.
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheel.h"
+
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QReadWriteLock>
+
+// =================
+// CLASS DECLARATION
+// =================
+
+class CogWheelIdNameCache
+{
+
+public:
+
+    // Class exception
+
+    struct Exception : public std::runtime_error {
+
+        Exception(const QString & messageStr)
+            : std::runtime_error(static_cast<QString>("CogWheelIdNameCache Failure: " + messageStr).toStdString()) {
+        }
+
+    };
+
+    // Get instance
+
+    static CogWheelIdNameCache& getInstance()
+    {
+        static CogWheelIdNameCache    instance;
+        return instance;
+    }
+
+    // Disable anything not needed
+
+    CogWheelIdNameCache(const CogWheelIdNameCache & orig) = delete;
+    CogWheelIdNameCache(const CogWheelIdNameCache && orig) = delete;
+    CogWheelIdNameCache& operator=(CogWheelIdNameCache other) = delete;
+
+    // Name for id (empty if none)
+
+    QString userName(uint userId);
+    QString groupName(uint groupId);
+
+    // UTF-8 name for id (empty if none)
+
+    QByteArray encodedUserName(uint userId);
+    QByteArray encodedGroupName(uint groupId);
+
+private:
+
+    // Cached name and when it expires
+
+    struct CachedName {
+        QString name;               // User/group name
+        QByteArray encodedName;     // User/group name (UTF-8)
+        qint64 expires=0;           // Expiry time (msecs since epoch)
+    };
+
+    // Constructor
+
+    CogWheelIdNameCache() {}
+
+    // Find id in cache or look it up
+
+    CachedName findName(QHash<uint, CachedName> &names, uint id, bool isGroup);
+
+    QReadWriteLock m_cacheLock;                 // Cache lock
+    QHash<uint, CachedName> m_userNames;        // User id to name
+    QHash<uint, CachedName> m_groupNames;       // Group id to name
+
+};
+
+#endif // COGWHEELIDNAMECACHE_H
@@ -0,0 +1,507 @@
+/*
+ * File:   cogwheelkerneltls.cpp
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+//
+// Class: CogWheelKernelTLS
+//
+// Description: Class to perform an encrypted (PROT P) data channel download
+// using kernel TLS. The handshake is done by OpenSSL directly on the socket
+// with kTLS enabled so that the negotiated keys are installed into the kernel
+// TLS ULP and the file can then be sent zero copy with SSL_sendfile(). If the
+// kernel or negotiated cipher does not support kTLS the file is sent through
+// SSL_write() instead. Only available on Linux when built with CONFIG+=ktls.
+// The TLS context is OpenSSL's own rather than the QSslSocket one used by the
+// control channel (which is internal to Qt) so a kTLS data channel cannot resume
+// the control channel session; its handshake is a full one (a client offering
+// the control session is treated as a session cache miss).
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheelkerneltls.h"
+#include "cogwheellogger.h"
+
+#if defined(Q_OS_LINUX) && defined(COGWHEEL_KTLS)
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#define COGWHEEL_KTLS_SUPPORTED   // SSL_OP_ENABLE_KTLS/SSL_sendfile() need OpenSSL 3.0
+#endif
+#endif
+
+// ====================
+// CLASS IMPLEMENTATION
+// ====================
+
+// Shared server TLS context (nullptr == kernel TLS not enabled)
+
+ssl_ctx_st *CogWheelKernelTLS::m_context=nullptr;
+
+/**
+ * @brief CogWheelKernelTLS::CogWheelKernelTLS
+ *
+ * Create kernel TLS download instance.
+ *
+ * @param controlSocketHandle   Control channel socket handle (logging).
+ * @param parent                Parent object.
+ */
+CogWheelKernelTLS::CogWheelKernelTLS(qintptr controlSocketHandle, QObject *parent) : QObject(parent),
+    m_controlSocketHandle(controlSocketHandle)
+{
+
+}
+
+/**
+ * @brief CogWheelKernelTLS::~CogWheelKernelTLS
+ *
+ * Destructor. Close down connection.
+ *
+ */
+CogWheelKernelTLS::~CogWheelKernelTLS()
+{
+    stop();
+}
+
+/**
+ * @brief CogWheelKernelTLS::setup
+ *
+ * Create the shared server TLS context with kTLS enabled from the
+ * server private key and certificate. This should be called once at
+ * server startup; if it fails encrypted downloads use QSslSocket.
+ *
+ * @param serverPrivateKey  Server private key (PEM).
+ * @param serverCert        Server certificate (PEM).
+ *
+ * @return  == true kernel TLS enabled.
+ */
+bool CogWheelKernelTLS::setup(const QByteArray &serverPrivateKey, const QByteArray &serverCert)
+{
+
+#ifdef COGWHEEL_KTLS_SUPPORTED
+
+    if (m_context) {
+        return(true);
+    }
+
+    SSL_CTX *context = SSL_CTX_new(TLS_server_method());
+
+    if (context==nullptr) {
+        cogWheelWarning("Could not create kernel TLS context.");
+        return(false);
+    }
+
+    SSL_CTX_set_min_proto_version(context, TLS1_2_VERSION);
+    SSL_CTX_set_options(context, SSL_OP_ENABLE_KTLS);
+    SSL_CTX_set_mode(context, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    SSL_CTX_set_session_id_context(context, reinterpret_cast<const unsigned char *>("CogWheel"), 8);
+
+    BIO *keyBio = BIO_new_mem_buf(serverPrivateKey.constData(), serverPrivateKey.size());
+    BIO *certBio = BIO_new_mem_buf(serverCert.constData(), serverCert.size());
+    EVP_PKEY *privateKey = PEM_read_bio_PrivateKey(keyBio, nullptr, nullptr, nullptr);
+    X509 *cert = PEM_read_bio_X509(certBio, nullptr, nullptr, nullptr);
+
+    bool contextValid = privateKey && cert &&
+            (SSL_CTX_use_certificate(context, cert)==1) &&
+            (SSL_CTX_use_PrivateKey(context, privateKey)==1) &&
+            (SSL_CTX_check_private_key(context)==1);
+
+    EVP_PKEY_free(privateKey);
+    X509_free(cert);
+    BIO_free(keyBio);
+    BIO_free(certBio);
+
+    if (!contextValid) {
+        cogWheelWarning("Could not load server private key/certificate for kernel TLS.");
+        SSL_CTX_free(context);
+        return(false);
+    }
+
+    m_context = context;
+
+    cogWheelInfo("Kernel TLS enabled for encrypted downloads.");
+
+    return(true);
+
+#else
+
+    Q_UNUSED(serverPrivateKey);
+    Q_UNUSED(serverCert);
+
+    cogWheelWarning("Kernel TLS not supported by this build.");
+
+    return(false);
+
+#endif
+
+}
+
+/**
+ * @brief CogWheelKernelTLS::isEnabled
+ *
+ * @return  == true kernel TLS context setup.
+ */
+bool CogWheelKernelTLS::isEnabled()
+{
+    return(m_context!=nullptr);
+}
+
+/**
+ * @brief CogWheelKernelTLS::start
+ *
+ * Start TLS handshake on a connected socket. The socket is made non
+ * blocking and its readiness watched so the handshake completes in the
+ * event loop. If this returns false the caller still owns the descriptor.
+ *
+ * @param socketDescriptor  Connected data channel socket.
+ *
+ * @return  == true handshake started.
+ */
+bool CogWheelKernelTLS::start(qintptr socketDescriptor)
+{
+
+#ifdef COGWHEEL_KTLS_SUPPORTED
+
+    if (!m_context || m_ssl) {
+        return(false);
+    }
+
+    int socketFlags = ::fcntl(static_cast<int>(socketDescriptor), F_GETFL);
+
+    if ((socketFlags==-1) || (::fcntl(static_cast<int>(socketDescriptor), F_SETFL, socketFlags | O_NONBLOCK)==-1)) {
+        return(false);
+    }
+
+    m_ssl = SSL_new(m_context);
+
+    if (!m_ssl || (SSL_set_fd(m_ssl, static_cast<int>(socketDescriptor))!=1)) {
+        cogWheelWarning(m_controlSocketHandle,"Could not create kernel TLS connection: "+sslErrorString());
+        SSL_free(m_ssl);
+        m_ssl=nullptr;
+        return(false);
+    }
+
+    m_socketDescriptor = static_cast<int>(socketDescriptor);
+
+    m_readNotifier = new QSocketNotifier(m_socketDescriptor, QSocketNotifier::Read, this);
+    m_writeNotifier = new QSocketNotifier(m_socketDescriptor, QSocketNotifier::Write, this);
+
+    connect(m_readNotifier, &QSocketNotifier::activated, this, &CogWheelKernelTLS::socketActivity);
+    connect(m_writeNotifier, &QSocketNotifier::activated, this, &CogWheelKernelTLS::socketActivity);
+
+    m_handshaking=true;
+
+    handshake();
+
+    return(true);
+
+#else
+
+    Q_UNUSED(socketDescriptor);
+
+    return(false);
+
+#endif
+
+}
+
+/**
+ * @brief CogWheelKernelTLS::sendFile
+ *
+ * Start sending file; when all of it has been sent (or there is an
+ * error) sendComplete() is signalled.
+ *
+ * @param fileDescriptor    File descriptor.
+ * @param fileOffset        Offset in file to start sending from.
+ * @param fileSize          Number of bytes to send.
+ */
+void CogWheelKernelTLS::sendFile(int fileDescriptor, qint64 fileOffset, quint64 fileSize)
+{
+
+    m_fileDescriptor = fileDescriptor;
+    m_fileOffset = fileOffset;
+    m_fileSize = fileSize;
+    m_writeBuffer.clear();
+
+    m_sending=true;
+
+    send();
+
+}
+
+/**
+ * @brief CogWheelKernelTLS::stop
+ *
+ * Remove socket notifiers, free connection and close socket.
+ *
+ */
+void CogWheelKernelTLS::stop()
+{
+
+    m_handshaking=m_sending=false;
+
+    if (m_readNotifier) {
+        m_readNotifier->setEnabled(false);
+        m_readNotifier->deleteLater();
+        m_readNotifier=nullptr;
+    }
+
+    if (m_writeNotifier) {
+        m_writeNotifier->setEnabled(false);
+        m_writeNotifier->deleteLater();
+        m_writeNotifier=nullptr;
+    }
+
+#ifdef COGWHEEL_KTLS_SUPPORTED
+
+    if (m_ssl) {
+        SSL_free(m_ssl);
+        m_ssl=nullptr;
+    }
+
+    if (m_socketDescriptor!=-1) {
+        ::close(m_socketDescriptor);
+        m_socketDescriptor=-1;
+    }
+
+#endif
+
+}
+
+/**
+ * @brief CogWheelKernelTLS::handshake
+ *
+ * Continue TLS handshake. Once complete note whether the kernel has
+ * taken over transmit encryption and signal handshakeComplete().
+ *
+ */
+void CogWheelKernelTLS::handshake()
+{
+
+#ifdef COGWHEEL_KTLS_SUPPORTED
+
+    ERR_clear_error();
+
+    int result = SSL_accept(m_ssl);
+
+    if (result==1) {
+
+        m_handshaking=false;
+        m_readNotifier->setEnabled(false);
+        m_writeNotifier->setEnabled(false);
+
+        m_kernelOffload = BIO_get_ktls_send(SSL_get_wbio(m_ssl));
+
+        if (m_kernelOffload) {
+            cogWheelInfo(m_controlSocketHandle,"Data channel encrypted using kernel TLS ("+QString(SSL_get_cipher(m_ssl))+").");
+        } else {
+            cogWheelInfo(m_controlSocketHandle,"Kernel TLS not available for cipher "+QString(SSL_get_cipher(m_ssl))+" so using SSL_write().");
+        }
+
+        emit handshakeComplete();
+        return;
+
+    }
+
+    int sslError = SSL_get_error(m_ssl, result);
+
+    if ((sslError==SSL_ERROR_WANT_READ) || (sslError==SSL_ERROR_WANT_WRITE)) {
+        waitFor(sslError);
+        return;
+    }
+
+    m_handshaking=false;
+    m_readNotifier->setEnabled(false);
+    m_writeNotifier->setEnabled(false);
+
+    emit handshakeFailed("Data channel TLS handshake failed: "+sslErrorString());
+
+#endif
+
+}
+
+/**
+ * @brief CogWheelKernelTLS::send
+ *
+ * Keep sending file until the socket would block or the whole file has
+ * been sent. With kernel offload SSL_sendfile() is used otherwise file
+ * blocks are read and passed to SSL_write().
+ *
+ */
+void CogWheelKernelTLS::send()
+{
+
+#ifdef COGWHEEL_KTLS_SUPPORTED
+
+    while (m_fileSize) {
+
+        ossl_ssize_t bytesSent;
+
+        ERR_clear_error();
+
+        if (m_kernelOffload) {
+            bytesSent = SSL_sendfile(m_ssl, m_fileDescriptor, m_fileOffset,
+                                     static_cast<size_t>(qMin(m_fileSize, kCWSendFileMaxBytes)), 0);
+        } else {
+            if (m_writeBuffer.isEmpty()) {
+                m_writeBuffer.resize(static_cast<int>(qMin(m_fileSize, kCWWriteBytesSize)));
+                ssize_t bytesRead = ::pread(m_fileDescriptor, m_writeBuffer.data(), static_cast<size_t>(m_writeBuffer.size()), m_fileOffset);
+                if (bytesRead <= 0) {
+                    cogWheelError(m_controlSocketHandle,"Download file read failure.");
+                    finish(false);
+                    return;
+                }
+                m_writeBuffer.resize(static_cast<int>(bytesRead));
+            }
+            bytesSent = SSL_write(m_ssl, m_writeBuffer.constData(), m_writeBuffer.size());
+            if (bytesSent > 0) {
+                m_writeBuffer.clear();
+            }
+        }
+
+        if (bytesSent > 0) {
+            m_fileOffset += bytesSent;
+            m_fileSize -= static_cast<quint64>(bytesSent);
+            continue;
+        }
+
+        int sslError = SSL_get_error(m_ssl, static_cast<int>(bytesSent));
+
+        if ((sslError==SSL_ERROR_WANT_READ) || (sslError==SSL_ERROR_WANT_WRITE)) {
+            waitFor(sslError);
+            return;
+        }
+
+        if (bytesSent==0) {
+            cogWheelError(m_controlSocketHandle,"File truncated during download.");
+        } else {
+            cogWheelError(m_controlSocketHandle,"Kernel TLS send failure: "+sslErrorString());
+        }
+
+        finish(false);
+        return;
+
+    }
+
+    finish(true);
+
+#endif
+
+}
+
+/**
+ * @brief CogWheelKernelTLS::finish
+ *
+ * File sent (or failed) so send TLS close notify and signal sendComplete().
+ *
+ * @param success   == true whole file sent.
+ */
+void CogWheelKernelTLS::finish(bool success)
+{
+
+    m_sending=false;
+
+    m_readNotifier->setEnabled(false);
+    m_writeNotifier->setEnabled(false);
+
+#ifdef COGWHEEL_KTLS_SUPPORTED
+    if (success) {
+        SSL_shutdown(m_ssl);
+    } else {
+        // Reset connection when closed so the client cannot take it as complete
+        struct linger abortLinger { 1, 0 };
+        ::setsockopt(m_socketDescriptor, SOL_SOCKET, SO_LINGER, &abortLinger, sizeof(abortLinger));
+    }
+#endif
+
+    emit sendComplete(success);
+
+}
+
+/**
+ * @brief CogWheelKernelTLS::waitFor
+ *
+ * Wait for socket to become readable/writeable as requested by OpenSSL.
+ *
+ * @param sslError  SSL_ERROR_WANT_READ/SSL_ERROR_WANT_WRITE.
+ */
+void CogWheelKernelTLS::waitFor(int sslError)
+{
+
+#ifdef COGWHEEL_KTLS_SUPPORTED
+    m_readNotifier->setEnabled(sslError==SSL_ERROR_WANT_READ);
+    m_writeNotifier->setEnabled(sslError==SSL_ERROR_WANT_WRITE);
+#else
+    Q_UNUSED(sslError);
+#endif
+
+}
+
+/**
+ * @brief CogWheelKernelTLS::sslErrorString
+ *
+ * @return  Last OpenSSL error as a string.
+ */
+QString CogWheelKernelTLS::sslErrorString() const
+{
+
+#ifdef COGWHEEL_KTLS_SUPPORTED
+
+    char errorBuffer[256];
+
+    unsigned long errorCode = ERR_peek_last_error();
+
+    if (errorCode==0) {
+        return("Connection closed.");
+    }
+
+    ERR_error_string_n(errorCode, errorBuffer, sizeof(errorBuffer));
+
+    return(QString(errorBuffer));
+
+#else
+
+    return(QString());
+
+#endif
+
+}
+
+/**
+ * @brief CogWheelKernelTLS::socketActivity
+ *
+ * Socket readable/writeable slot function. Continue handshake or send.
+ *
+ */
+void CogWheelKernelTLS::socketActivity()
+{
+
+    if (m_handshaking) {
+        handshake();
+    } else if (m_sending) {
+        send();
+    }
+
+}
+
+// ============================
+// CLASS PRIVATE DATA ACCESSORS
+// ============================
+
+bool CogWheelKernelTLS::isKernelOffload() const
+{
+    return m_kernelOffload;
+}
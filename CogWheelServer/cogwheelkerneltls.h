@@ -0,0 +1,131 @@
+/*
+ * File:   cogwheelkerneltls.h
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+#ifndef COGWHEELKERNELTLS_H
+#define COGWHEELKERNELTLS_H
+
+//
+// Class: CogWheelKernelTLS
+//
+// Description: Class to perform an encrypted (PROT P) data channel download
+// using kernel TLS. The handshake is done by OpenSSL directly on the socket
+// with kTLS enabled so that the negotiated keys are installed into the kernel
+// TLS ULP and the file can then be sent zero copy with SSL_sendfile(). If the
+// kernel or negotiated cipher does not support kTLS the file is sent through
+// SSL_write() instead. Only available on Linux when built with CONFIG+=ktls.
+// The TLS context is OpenSSL's own rather than the QSslSocket one used by the
+// control channel (which is internal to Qt) so a kTLS data channel cannot resume
+// the control channel session; its handshake is a full one (a client offering
+// the control session is treated as a session cache miss).
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheel.h"
+
+#include <QObject>
+#include <QByteArray>
+#include <QSocketNotifier>
+
+// OpenSSL forward declarations
+
+struct ssl_st;
+struct ssl_ctx_st;
+
+// =================
+// CLASS DECLARATION
+// =================
+
+class CogWheelKernelTLS : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    // Class exception
+
+    struct Exception : public std::runtime_error {
+
+        Exception(const QString & messageStr)
+            : std::runtime_error(static_cast<QString>("CogWheelKernelTLS Failure: " + messageStr).toStdString()) {
+        }
+
+    };
+
+    // Constructor / Destructor
+
+    explicit CogWheelKernelTLS(qintptr controlSocketHandle, QObject *parent = nullptr);
+    ~CogWheelKernelTLS();
+
+    // Shared TLS context setup
+
+    static bool setup(const QByteArray &serverPrivateKey, const QByteArray &serverCert);
+    static bool isEnabled();
+
+    // Start handshake on socket (takes ownership of descriptor if started)
+
+    bool start(qintptr socketDescriptor);
+
+    // Send file once handshake complete
+
+    void sendFile(int fileDescriptor, qint64 fileOffset, quint64 fileSize);
+
+    // Close down
+
+    void stop();
+
+    // Private data accessors
+
+    bool isKernelOffload() const;
+
+signals:
+
+    void handshakeComplete();                   // TLS handshake complete
+    void handshakeFailed(const QString &message);// TLS handshake failed
+    void sendComplete(bool success);            // File sent (or failed)
+
+private:
+
+    // Handshake/send steps
+
+    void handshake();
+    void send();
+    void finish(bool success);
+    void waitFor(int sslError);
+
+    QString sslErrorString() const;
+
+private slots:
+
+    void socketActivity();
+
+private:
+
+    qintptr m_controlSocketHandle;              // Control channel socket handle
+    int m_socketDescriptor=-1;                  // Data channel socket descriptor
+    ssl_st *m_ssl=nullptr;                      // OpenSSL connection
+    QSocketNotifier *m_readNotifier=nullptr;    // Socket readable notifier
+    QSocketNotifier *m_writeNotifier=nullptr;   // Socket writeable notifier
+    bool m_handshaking=false;                   // == true handshake in progress
+    bool m_sending=false;                       // == true file being sent
+    bool m_kernelOffload=false;                 // == true kernel TLS transmit active
+    int m_fileDescriptor=-1;                    // File being sent
+    qint64 m_fileOffset=0;                      // Current file offset
+    quint64 m_fileSize=0;                       // Bytes left to send
+    QByteArray m_writeBuffer;                   // SSL_write() buffer (no offload)
+
+    static ssl_ctx_st *m_context;               // Shared server TLS context
+
+};
+
+#endif // COGWHEELKERNELTLS_H
@@ -0,0 +1,202 @@
+/*
+ * File:   cogwheellistener.cpp
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+//
+// Class: CogWheelListener
+//
+// Description: Class to listen for FTP control connections on a connection
+// pool thread. Each pool thread has its own listener bound to the server port
+// with SO_REUSEPORT so that the kernel spreads incoming connections between
+// them; a connection is accepted and its control channel created on the listeners
+// own thread, registered with the connections handler and then opened back on it.
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheellistener.h"
+#include "cogwheellogger.h"
+
+#include <QThread>
+
+#ifdef Q_OS_LINUX
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+// ====================
+// CLASS IMPLEMENTATION
+// ====================
+
+/**
+ * @brief CogWheelListener::CogWheelListener
+ *
+ * Create listener.
+ *
+ * @param serverSettings    Server settings (passed onto control channels).
+ * @param parent            Parent object.
+ */
+CogWheelListener::CogWheelListener(const CogWheelServerSettings &serverSettings, QObject *parent)
+    : QTcpServer(parent), m_serverSettings(serverSettings), m_acceptCount(0)
+{
+
+}
+
+/**
+ * @brief CogWheelListener::~CogWheelListener
+ *
+ * Destructor.
+ *
+ */
+CogWheelListener::~CogWheelListener()
+{
+
+}
+
+/**
+ * @brief CogWheelListener::isSupported
+ *
+ * @return  == true SO_REUSEPORT listeners supported.
+ */
+bool CogWheelListener::isSupported()
+{
+#ifdef Q_OS_LINUX
+    return(true);
+#else
+    return(false);
+#endif
+}
+
+/**
+ * @brief CogWheelListener::startListening
+ *
+ * Create a listening socket bound to the server port with SO_REUSEPORT set and
+ * hand it to QTcpServer. Must be called on the thread the listener lives on so
+ * that its socket notifier runs on that threads event loop.
+ *
+ * @param port  Server port.
+ *
+ * @return  == true listening.
+ */
+bool CogWheelListener::startListening(quint16 port)
+{
+
+#ifdef Q_OS_LINUX
+
+    int listenSocket = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    if (listenSocket == -1) {
+        cogWheelError("Listener socket creation failure: "+QString(std::strerror(errno)));
+        return(false);
+    }
+
+    int enable=1;
+
+    if ((::setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) == -1) ||
+            (::setsockopt(listenSocket, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) == -1)) {
+        cogWheelError("Listener SO_REUSEPORT failure: "+QString(std::strerror(errno)));
+        ::close(listenSocket);
+        return(false);
+    }
+
+    struct sockaddr_in listenAddress;
+
+    std::memset(&listenAddress, 0, sizeof(listenAddress));
+    listenAddress.sin_family = AF_INET;
+    listenAddress.sin_addr.s_addr = htonl(INADDR_ANY);
+    listenAddress.sin_port = htons(port);
+
+    if ((::bind(listenSocket, reinterpret_cast<struct sockaddr *>(&listenAddress), sizeof(listenAddress)) == -1) ||
+            (::listen(listenSocket, SOMAXCONN) == -1)) {
+        cogWheelError("Listener bind/listen failure on port "+QString::number(port)+": "+QString(std::strerror(errno)));
+        ::close(listenSocket);
+        return(false);
+    }
+
+    if (!setSocketDescriptor(listenSocket)) {
+        cogWheelError("Listener socket setup failure: "+errorString());
+        ::close(listenSocket);
+        return(false);
+    }
+
+    cogWheelInfo("Listener on "+QThread::currentThread()->objectName()+" listening on port "+QString::number(port));
+
+    return(true);
+
+#else
+
+    Q_UNUSED(port);
+
+    return(false);
+
+#endif
+
+}
+
+/**
+ * @brief CogWheelListener::stopListening
+ *
+ * Stop listening for connections.
+ *
+ */
+void CogWheelListener::stopListening()
+{
+    close();
+}
+
+/**
+ * @brief CogWheelListener::incomingConnection
+ *
+ * QTcpServer override for incoming connections. Create a control channel on
+ * this thread and pass it to the connections handler which registers it and
+ * then queues it to be opened back on this thread; so it is never opened (and
+ * cannot finish) before its signals have been connected.
+ *
+ * @param handle    Client connecting socket handle.
+ */
+void CogWheelListener::incomingConnection(qintptr handle)
+{
+
+    m_acceptCount++;
+
+    cogWheelInfo("--- CogWheel Listener incoming connection --- "+QString::number(handle));
+
+    CogWheelControlChannel *connection = new CogWheelControlChannel(m_serverSettings);
+
+    if (connection==nullptr) {
+        cogWheelError("Could not create connection object.");
+        return;
+    }
+
+    connection->setConnectionThread(QThread::currentThread());
+
+    emit connectionOpened(handle, connection);
+
+}
+
+// ============================
+// CLASS PRIVATE DATA ACCESSORS
+// ============================
+
+/**
+ * @brief CogWheelListener::acceptCount
+ * @return
+ */
+quint64 CogWheelListener::acceptCount() const
+{
+    return m_acceptCount.load();
+}
@@ -0,0 +1,96 @@
+/*
+ * File:   cogwheellistener.h
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+#ifndef COGWHEELLISTENER_H
+#define COGWHEELLISTENER_H
+
+//
+// Class: CogWheelListener
+//
+// Description: Class to listen for FTP control connections on a connection
+// pool thread. Each pool thread has its own listener bound to the server port
+// with SO_REUSEPORT so that the kernel spreads incoming connections between
+// them; a connection is accepted and its control channel created on the listeners
+// own thread, registered with the connections handler and then opened back on it.
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheel.h"
+#include "cogwheelcontrolchannel.h"
+#include "cogwheelserversettings.h"
+
+#include <QObject>
+#include <QTcpServer>
+#include <QAtomicInteger>
+
+// =================
+// CLASS DECLARATION
+// =================
+
+class CogWheelListener : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+
+    // Class exception
+
+    struct Exception : public std::runtime_error {
+
+        Exception(const QString & messageStr)
+            : std::runtime_error(static_cast<QString>("CogWheelListener Failure: " + messageStr).toStdString()) {
+        }
+
+    };
+
+    // Constructor / Destructor
+
+    explicit CogWheelListener(const CogWheelServerSettings &serverSettings, QObject *parent = nullptr);
+    ~CogWheelListener();
+
+    // SO_REUSEPORT supported on this platform
+
+    static bool isSupported();
+
+    // Private data accessors
+
+    quint64 acceptCount() const;
+
+protected:
+
+    // QTcpServer overrides
+
+    void incomingConnection(qintptr handle);
+
+signals:
+
+    // New connection accepted on listener thread (to register then open)
+
+    void connectionOpened(qint64 handle, CogWheelControlChannel *connection);
+
+public slots:
+
+    // Start/stop listening (called on listener thread)
+
+    bool startListening(quint16 port);
+    void stopListening();
+
+private:
+
+    CogWheelServerSettings m_serverSettings;    // Server settings
+    QAtomicInteger<quint64> m_acceptCount;      // Connections accepted on listener
+
+};
+
+#endif // COGWHEELLISTENER_H
@@ -0,0 +1,450 @@
+/*
+ * File:   cogwheellistingcache.cpp
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+//
+// Class: CogWheelListingCache
+//
+// Description: Singleton class to keep rendered directory listings (LIST/NLST/MLSD
+// bytes) so that repeated listings of an unchanged directory are just a copy. Entries
+// are kept least recently used first up to a memory cap and every cached directory is
+// watched with inotify; any change to it drops its entries. Queued change events are
+// read before every lookup so a client never sees a listing older than its own last
+// change, and a directory stops being watched once none of its listings are cached.
+// Only available on Linux.
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheellistingcache.h"
+#include "cogwheellogger.h"
+
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+#include <climits>
+
+// ====================
+// CLASS IMPLEMENTATION
+// ====================
+
+/**
+ * @brief CogWheelListingCache::CachedListing::~CachedListing
+ *
+ * Destructor. Listing dropped or evicted so tell the cache (which always
+ * holds its mutex when changing the listings).
+ *
+ */
+CogWheelListingCache::CachedListing::~CachedListing()
+{
+
+    if (m_notify) {
+        m_cache->listingRemoved(m_path, m_key);
+    }
+
+}
+
+/**
+ * @brief CogWheelListingCache::~CogWheelListingCache
+ *
+ * Destructor. Drop listings (and their watches) then close inotify descriptor.
+ *
+ */
+CogWheelListingCache::~CogWheelListingCache()
+{
+
+    QMutexLocker cacheLock { &m_cacheMutex };
+
+    m_listings.clear();
+
+#ifdef Q_OS_LINUX
+    if (m_inotifyDescriptor!=-1) {
+        ::close(m_inotifyDescriptor);
+    }
+#endif
+
+}
+
+/**
+ * @brief CogWheelListingCache::setup
+ *
+ * Set cache memory cap and create the inotify descriptor used to watch
+ * cached directories. This should be called once at server startup from
+ * the main thread (which then processes the change events).
+ *
+ * @param maxBytes  Memory cap in bytes (0 == cache disabled).
+ */
+void CogWheelListingCache::setup(quint64 maxBytes)
+{
+
+#ifdef Q_OS_LINUX
+
+    QMutexLocker cacheLock { &m_cacheMutex };
+
+    if ((maxBytes==0) || (m_inotifyDescriptor!=-1)) {
+        return;
+    }
+
+    m_inotifyDescriptor = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (m_inotifyDescriptor==-1) {
+        cogWheelWarning("Listing cache disabled as inotify not available: "+QString(std::strerror(errno)));
+        return;
+    }
+
+    m_inotifyNotifier = new QSocketNotifier(m_inotifyDescriptor, QSocketNotifier::Read, this);
+
+    connect(m_inotifyNotifier, &QSocketNotifier::activated, this, &CogWheelListingCache::directoryChanged);
+
+    m_listings.setMaxCost(static_cast<int>(qMin(maxBytes, static_cast<quint64>(INT_MAX))));
+    m_maxBytes = static_cast<quint64>(m_listings.maxCost());
+
+    cogWheelInfo("Listing cache enabled ("+QString::number(m_maxBytes)+" bytes).");
+
+#else
+
+    Q_UNUSED(maxBytes);
+
+#endif
+
+}
+
+/**
+ * @brief CogWheelListingCache::watch
+ *
+ * Start watching directory for changes (if not already) and return its
+ * current change generation. A listing may only be inserted with the
+ * generation returned before it was built; so a listing of a directory that
+ * changed while being built is never cached.
+ *
+ * @param path  Local directory path.
+ *
+ * @return  Directory generation (0 == cannot be cached).
+ */
+quint64 CogWheelListingCache::watch(const QString &path)
+{
+
+#ifdef Q_OS_LINUX
+
+    if (!isEnabled()) {
+        return(0);
+    }
+
+    QMutexLocker cacheLock { &m_cacheMutex };
+
+    readEvents();
+
+    if (!m_pathWatches.contains(path)) {
+
+        int watch = ::inotify_add_watch(m_inotifyDescriptor, path.toUtf8().constData(),
+                                        IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB |
+                                        IN_MODIFY | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+        if (watch==-1) {
+            return(0);
+        }
+
+        m_watchPaths[watch] = path;
+        m_pathWatches[path] = watch;
+        m_pathGeneration[path] = m_nextGeneration++;
+
+    }
+
+    return(m_pathGeneration.value(path));
+
+#else
+
+    Q_UNUSED(path);
+
+    return(0);
+
+#endif
+
+}
+
+/**
+ * @brief CogWheelListingCache::release
+ *
+ * Listing of directory is not going to be inserted (too large or abandoned)
+ * so stop watching it unless it still has cached listings.
+ *
+ * @param path  Local directory path.
+ */
+void CogWheelListingCache::release(const QString &path)
+{
+
+    if (!isEnabled()) {
+        return;
+    }
+
+    QMutexLocker cacheLock { &m_cacheMutex };
+
+    if (!m_pathKeys.contains(path)) {
+        unwatch(path);
+    }
+
+}
+
+/**
+ * @brief CogWheelListingCache::find
+ *
+ * Find rendered listing in cache. Any queued directory change events are
+ * processed first; inotify queues them as part of the change so a client
+ * listing straight after its own STOR/DELE/RNTO etc. sees the change.
+ *
+ * @param key       Listing key (path, format, options).
+ * @param listing   Returned listing (shared copy).
+ *
+ * @return  == true listing found.
+ */
+bool CogWheelListingCache::find(const QString &key, QByteArray &listing)
+{
+
+    if (!isEnabled()) {
+        return(false);
+    }
+
+    QMutexLocker cacheLock { &m_cacheMutex };
+
+    readEvents();
+
+    CachedListing *cachedListing = m_listings.object(key);
+
+    if (cachedListing==nullptr) {
+        m_missCount++;
+        return(false);
+    }
+
+    m_hitCount++;
+
+    listing = cachedListing->m_listing;
+
+    return(true);
+
+}
+
+/**
+ * @brief CogWheelListingCache::insert
+ *
+ * Insert rendered listing into cache evicting least recently used listings
+ * to stay under the memory cap. Ignored if the directory has changed since
+ * the passed generation was obtained. A listing that cannot be kept leaves
+ * the directory unwatched if it has no other cached listings.
+ *
+ * @param path          Local directory path.
+ * @param key           Listing key (path, format, options).
+ * @param listing       Rendered listing.
+ * @param generation    Directory generation from watch().
+ */
+void CogWheelListingCache::insert(const QString &path, const QString &key, const QByteArray &listing, quint64 generation)
+{
+
+    if (!isEnabled() || (generation==0)) {
+        return;
+    }
+
+    QMutexLocker cacheLock { &m_cacheMutex };
+
+    if (m_pathGeneration.value(path)!=generation) {
+        return;
+    }
+
+    // Replacing a listing must not unwatch its directory
+
+    CachedListing *oldListing = m_listings.take(key);
+
+    if (oldListing) {
+        oldListing->m_notify = false;
+        delete oldListing;
+    }
+
+    // Key added first as a failed insert deletes (and so removes) the listing
+
+    m_pathKeys[path].insert(key);
+
+    m_listings.insert(key, new CachedListing(this, path, key, listing), qMax(listing.size(), 1));
+
+}
+
+/**
+ * @brief CogWheelListingCache::statistics
+ *
+ * @return  Utilisation statistics string.
+ */
+QString CogWheelListingCache::statistics()
+{
+
+    QMutexLocker cacheLock { &m_cacheMutex };
+
+    return("Listing cache: "+QString::number(m_hitCount)+" hits, "+QString::number(m_missCount)+" misses, "+
+           QString::number(m_listings.count())+" listings ("+QString::number(m_listings.totalCost())+"/"+
+           QString::number(m_maxBytes)+" bytes), "+QString::number(m_invalidateCount)+" invalidations");
+
+}
+
+/**
+ * @brief CogWheelListingCache::invalidate
+ *
+ * Drop all listings for directory and stop watching it; any listing being
+ * built from before the change then fails its generation check on insert.
+ * Called with the cache mutex held.
+ *
+ * @param path  Local directory path.
+ */
+void CogWheelListingCache::invalidate(const QString &path)
+{
+
+    for (const QString &key : m_pathKeys.take(path)) {
+        CachedListing *cachedListing = m_listings.take(key);
+        if (cachedListing) {
+            cachedListing->m_notify = false;
+            delete cachedListing;
+        }
+    }
+
+    unwatch(path);
+
+    m_invalidateCount++;
+
+}
+
+/**
+ * @brief CogWheelListingCache::listingRemoved
+ *
+ * Listing dropped or evicted from cache; stop watching its directory when
+ * no cached listing refers to it. Called with the cache mutex held.
+ *
+ * @param path  Local directory path.
+ * @param key   Listing key.
+ */
+void CogWheelListingCache::listingRemoved(const QString &path, const QString &key)
+{
+
+    auto pathKeys = m_pathKeys.find(path);
+
+    if (pathKeys==m_pathKeys.end()) {
+        return;
+    }
+
+    pathKeys->remove(key);
+
+    if (pathKeys->isEmpty()) {
+        m_pathKeys.erase(pathKeys);
+        unwatch(path);
+    }
+
+}
+
+/**
+ * @brief CogWheelListingCache::unwatch
+ *
+ * Remove directory inotify watch and generation. Called with the cache
+ * mutex held.
+ *
+ * @param path  Local directory path.
+ */
+void CogWheelListingCache::unwatch(const QString &path)
+{
+
+#ifdef Q_OS_LINUX
+
+    auto pathWatch = m_pathWatches.find(path);
+
+    if (pathWatch!=m_pathWatches.end()) {
+        ::inotify_rm_watch(m_inotifyDescriptor, pathWatch.value());
+        m_watchPaths.remove(pathWatch.value());
+        m_pathWatches.erase(pathWatch);
+    }
+
+    m_pathGeneration.remove(path);
+
+#else
+
+    Q_UNUSED(path);
+
+#endif
+
+}
+
+/**
+ * @brief CogWheelListingCache::directoryChanged
+ *
+ * inotify descriptor readable slot function. Process any queued events not
+ * already read by a lookup.
+ *
+ */
+void CogWheelListingCache::directoryChanged()
+{
+
+    QMutexLocker cacheLock { &m_cacheMutex };
+
+    readEvents();
+
+}
+
+/**
+ * @brief CogWheelListingCache::readEvents
+ *
+ * Read all queued inotify events (descriptor is non-blocking) and invalidate
+ * the listings of each directory changed. Called with the cache mutex held.
+ *
+ */
+void CogWheelListingCache::readEvents()
+{
+
+#ifdef Q_OS_LINUX
+
+    alignas(struct inotify_event) char eventBuffer[4096];
+
+    for (;;) {
+
+        ssize_t bytesRead = ::read(m_inotifyDescriptor, eventBuffer, sizeof(eventBuffer));
+
+        if (bytesRead <= 0) {
+            break;
+        }
+
+        for (char *eventPtr = eventBuffer; eventPtr < eventBuffer+bytesRead; ) {
+
+            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(eventPtr);
+            QString path { m_watchPaths.value(event->wd) };
+
+            if (!path.isEmpty()) {
+                invalidate(path);
+            }
+
+            eventPtr += sizeof(struct inotify_event)+event->len;
+
+        }
+
+    }
+
+#endif
+
+}
+
+// ============================
+// CLASS PRIVATE DATA ACCESSORS
+// ============================
+
+bool CogWheelListingCache::isEnabled() const
+{
+    return(m_maxBytes!=0);
+}
+
+quint64 CogWheelListingCache::maxBytes() const
+{
+    return m_maxBytes;
+}
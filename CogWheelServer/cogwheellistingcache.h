@@ -0,0 +1,158 @@
+/*
+ * File:   cogwheellistingcache.h
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+#ifndef COGWHEELLISTINGCACHE_H
+#define COGWHEELLISTINGCACHE_H
+
+//
+// Class: CogWheelListingCache
+//
+// Description: Singleton class to keep rendered directory listings (LIST/NLST/MLSD
+// bytes) so that repeated listings of an unchanged directory are just a copy. Entries
+// are kept least recently used first up to a memory cap and every cached directory is
+// watched with inotify; any change to it drops its entries. Queued change events are
+// read before every lookup so a client never sees a listing older than its own last
+// change, and a directory stops being watched once none of its listings are cached.
+// Only available on Linux.
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheel.h"
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QCache>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QSocketNotifier>
+
+// =================
+// CLASS DECLARATION
+// =================
+
+class CogWheelListingCache : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    // Class exception
+
+    struct Exception : public std::runtime_error {
+
+        Exception(const QString & messageStr)
+            : std::runtime_error(static_cast<QString>("CogWheelListingCache Failure: " + messageStr).toStdString()) {
+        }
+
+    };
+
+    // Get instance
+
+    static CogWheelListingCache& getInstance()
+    {
+        static CogWheelListingCache    instance;
+        return instance;
+    }
+
+    // Disable anything not needed
+
+    CogWheelListingCache(const CogWheelListingCache & orig) = delete;
+    CogWheelListingCache(const CogWheelListingCache && orig) = delete;
+    CogWheelListingCache& operator=(CogWheelListingCache other) = delete;
+
+    // Setup cache (0 == disabled); call from main thread
+
+    void setup(quint64 maxBytes);
+
+    // Watch directory for changes (0 == cannot be cached)
+
+    quint64 watch(const QString &path);
+
+    // Stop watching directory if it has no cached listings
+
+    void release(const QString &path);
+
+    // Find/insert rendered listing
+
+    bool find(const QString &key, QByteArray &listing);
+    void insert(const QString &path, const QString &key, const QByteArray &listing, quint64 generation);
+
+    // Utilisation statistics
+
+    QString statistics();
+
+    // Private data accessors
+
+    bool isEnabled() const;
+    quint64 maxBytes() const;
+
+private:
+
+    // Constructor / Destructor
+
+    CogWheelListingCache() {}
+    ~CogWheelListingCache();
+
+    // Cached listing (tells cache when it is dropped or evicted)
+
+    struct CachedListing {
+        CachedListing(CogWheelListingCache *cache, const QString &path, const QString &key, const QByteArray &listing)
+            : m_cache(cache), m_path(path), m_key(key), m_listing(listing) {
+        }
+        ~CachedListing();
+        CogWheelListingCache *m_cache;  // Owning cache
+        QString m_path;                 // Local directory path
+        QString m_key;                  // Listing key
+        QByteArray m_listing;           // Rendered listing
+        bool m_notify=true;             // == true tell cache when removed
+    };
+
+    // Drop all listings for a directory
+
+    void invalidate(const QString &path);
+
+    // Listing removed from cache / stop watching directory
+
+    void listingRemoved(const QString &path, const QString &key);
+    void unwatch(const QString &path);
+
+    // Read queued inotify events
+
+    void readEvents();
+
+private slots:
+
+    void directoryChanged();   // inotify event(s) ready
+
+private:
+
+    QMutex m_cacheMutex;                        // Cache access mutex
+    QCache<QString, CachedListing> m_listings;  // Listings (cost == bytes, LRU evicted)
+    QHash<QString, QSet<QString>> m_pathKeys;   // Directory to its listing keys
+    QHash<QString, quint64> m_pathGeneration;   // Directory change generation
+    QHash<int, QString> m_watchPaths;           // inotify watch to directory
+    QHash<QString, int> m_pathWatches;          // Directory to inotify watch
+    int m_inotifyDescriptor=-1;                 // inotify descriptor
+    QSocketNotifier *m_inotifyNotifier=nullptr; // inotify readable notifier
+    quint64 m_maxBytes=0;                       // Memory cap (0 == disabled)
+    quint64 m_nextGeneration=1;                 // Next directory generation
+    quint64 m_hitCount=0;                       // Cache hits
+    quint64 m_missCount=0;                      // Cache misses
+    quint64 m_invalidateCount=0;                // Directory change invalidations
+
+};
+
+#endif // COGWHEELLISTINGCACHE_H
@@ -0,0 +1,201 @@
+/*
+ * File:   cogwheelpassiveports.cpp
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+//
+// Class: CogWheelPassivePorts
+//
+// Description: Singleton class to allocate passive data channel ports from the
+// passiveportlow..passiveporthigh range. Ports in use are kept in a bitmap of
+// atomic 64 bit words so acquire/release need no locking; acquire claims the first
+// clear bit found starting at a rotating word (or a random port) and release just
+// clears its bit. Utilisation statistics are also kept.
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheelpassiveports.h"
+#include "cogwheellogger.h"
+
+#include <QtAlgorithms>
+#include <QRandomGenerator>
+
+// ====================
+// CLASS IMPLEMENTATION
+// ====================
+
+/**
+ * @brief CogWheelPassivePorts::setRange
+ *
+ * Set passive port range and create its bitmap. Any bits past the end of
+ * the range in the last word are marked as used so they are never handed
+ * out. This should only be called at server startup before any ports
+ * have been acquired.
+ *
+ * @param portLow       Passive port low range (0 == no range).
+ * @param portHigh      Passive port high range.
+ * @param randomStart   == true start each search at a random port.
+ */
+void CogWheelPassivePorts::setRange(quint64 portLow, quint64 portHigh, bool randomStart)
+{
+
+    if (m_portsInUse.load()) {
+        cogWheelWarning("Passive port range not changed as ports are in use.");
+        return;
+    }
+
+    m_randomStart = randomStart;
+
+    if ((portLow==0) || (portHigh < portLow)) {
+        m_portLow = m_portCount = 0;
+        m_wordCount = 0;
+        m_portMap.reset();
+        return;
+    }
+
+    m_portLow = portLow;
+    m_portCount = portHigh-portLow+1;
+    m_wordCount = static_cast<int>((m_portCount+63)/64);
+    m_portMap.reset(new QAtomicInteger<quint64>[m_wordCount]);
+
+    for (int wordNo=0; wordNo < m_wordCount; wordNo++) {
+        m_portMap[wordNo].store(0);
+    }
+
+    if (m_portCount % 64) {
+        m_portMap[m_wordCount-1].store(~((Q_UINT64_C(1) << (m_portCount % 64))-1));
+    }
+
+    m_nextWord.store(0);
+    m_peakPortsInUse.store(0);
+    m_exhaustedCount.store(0);
+
+}
+
+/**
+ * @brief CogWheelPassivePorts::acquire
+ *
+ * Acquire a free port from range. A word with a free bit is looked for
+ * starting at the next word and its lowest free bit claimed with a compare
+ * and swap; if another thread gets there first the word is re-read and tried
+ * again. In random mode the search starts at a random word and bit (the word
+ * is rotated before looking for a free bit) so any free port may be handed
+ * out.
+ *
+ * @return  Port acquired (0 == none so use any port).
+ */
+quint64 CogWheelPassivePorts::acquire()
+{
+
+    // Range not set (use any port)
+
+    if (m_portCount==0) {
+        return(0);
+    }
+
+    int startWord = static_cast<int>(m_nextWord.load() % m_wordCount);
+    uint startBit = 0;
+
+    if (m_randomStart) {
+        quint64 randomPort = QRandomGenerator::global()->bounded(static_cast<quint64>(m_wordCount)*64);
+        startWord = static_cast<int>(randomPort / 64);
+        startBit = static_cast<uint>(randomPort % 64);
+    }
+
+    for (int wordNo=0; wordNo < m_wordCount; wordNo++) {
+
+        int currentWord = (startWord+wordNo) % m_wordCount;
+        quint64 portBits = m_portMap[currentWord].load();
+
+        while (portBits != ~Q_UINT64_C(0)) {
+            quint64 rotatedBits = (startBit) ? ((portBits >> startBit) | (portBits << (64-startBit))) : portBits;
+            uint freeBit = (qCountTrailingZeroBits(~rotatedBits)+startBit) % 64;
+            if (m_portMap[currentWord].testAndSetOrdered(portBits, portBits | (Q_UINT64_C(1) << freeBit))) {
+                quint64 portsInUse = m_portsInUse.fetchAndAddOrdered(1)+1;
+                quint64 peakPortsInUse = m_peakPortsInUse.load();
+                while ((portsInUse > peakPortsInUse) && !m_peakPortsInUse.testAndSetOrdered(peakPortsInUse, portsInUse)) {
+                    peakPortsInUse = m_peakPortsInUse.load();
+                }
+                m_nextWord.store(static_cast<quint32>(currentWord));
+                return(m_portLow+(static_cast<quint64>(currentWord)*64)+freeBit);
+            }
+            portBits = m_portMap[currentWord].load();
+        }
+
+    }
+
+    // All ports being used (use any port)
+
+    m_exhaustedCount.fetchAndAddOrdered(1);
+
+    return(0);
+
+}
+
+/**
+ * @brief CogWheelPassivePorts::release
+ *
+ * Release port back to range by clearing its bit.
+ *
+ * @param port  Port to release.
+ */
+void CogWheelPassivePorts::release(quint64 port)
+{
+
+    if ((port < m_portLow) || (port >= m_portLow+m_portCount)) {
+        return;
+    }
+
+    quint64 portIndex = port-m_portLow;
+    quint64 portMask = Q_UINT64_C(1) << (portIndex % 64);
+
+    if (m_portMap[static_cast<int>(portIndex/64)].fetchAndAndOrdered(~portMask) & portMask) {
+        m_portsInUse.fetchAndSubOrdered(1);
+    }
+
+}
+
+/**
+ * @brief CogWheelPassivePorts::statistics
+ *
+ * @return  Utilisation statistics string.
+ */
+QString CogWheelPassivePorts::statistics() const
+{
+    return("Passive ports: "+QString::number(portsInUse())+"/"+QString::number(portCount())+
+           " in use (peak "+QString::number(peakPortsInUse())+", "+
+           QString::number(exhaustedCount())+" exhausted)");
+}
+
+// ============================
+// CLASS PRIVATE DATA ACCESSORS
+// ============================
+
+quint64 CogWheelPassivePorts::portCount() const
+{
+    return m_portCount;
+}
+
+quint64 CogWheelPassivePorts::portsInUse() const
+{
+    return m_portsInUse.load();
+}
+
+quint64 CogWheelPassivePorts::peakPortsInUse() const
+{
+    return m_peakPortsInUse.load();
+}
+
+quint64 CogWheelPassivePorts::exhaustedCount() const
+{
+    return m_exhaustedCount.load();
+}
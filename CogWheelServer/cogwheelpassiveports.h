@@ -0,0 +1,106 @@
+/*
+ * File:   cogwheelpassiveports.h
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+#ifndef COGWHEELPASSIVEPORTS_H
+#define COGWHEELPASSIVEPORTS_H
+
+//
+// Class: CogWheelPassivePorts
+//
+// Description: Singleton class to allocate passive data channel ports from the
+// passiveportlow..passiveporthigh range. Ports in use are kept in a bitmap of
+// atomic 64 bit words so acquire/release need no locking; acquire claims the first
+// clear bit found starting at a rotating word (or a random port) and release just
+// clears its bit. Utilisation statistics are also kept.
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheel.h"
+
+#include <QString>
+#include <QAtomicInteger>
+#include <QScopedArrayPointer>
+
+// =================
+// CLASS DECLARATION
+// =================
+
+class CogWheelPassivePorts
+{
+
+public:
+
+    // Class exception
+
+    struct Exception : public std::runtime_error {
+
+        Exception(const QString & messageStr)
+            : std::runtime_error(static_cast<QString>("CogWheelPassivePorts Failure: " + messageStr).toStdString()) {
+        }
+
+    };
+
+    // Get instance
+
+    static CogWheelPassivePorts& getInstance()
+    {
+        static CogWheelPassivePorts    instance;
+        return instance;
+    }
+
+    // Disable anything not needed
+
+    CogWheelPassivePorts(const CogWheelPassivePorts & orig) = delete;
+    CogWheelPassivePorts(const CogWheelPassivePorts && orig) = delete;
+    CogWheelPassivePorts& operator=(CogWheelPassivePorts other) = delete;
+
+    // Set port range (only when no ports allocated)
+
+    void setRange(quint64 portLow, quint64 portHigh, bool randomStart);
+
+    // Acquire/release port (0 == use any port)
+
+    quint64 acquire();
+    void release(quint64 port);
+
+    // Utilisation statistics
+
+    QString statistics() const;
+
+    // Private data accessors
+
+    quint64 portCount() const;
+    quint64 portsInUse() const;
+    quint64 peakPortsInUse() const;
+    quint64 exhaustedCount() const;
+
+private:
+
+    // Constructor
+
+    CogWheelPassivePorts() {}
+
+    quint64 m_portLow=0;                                // Passive port low range
+    quint64 m_portCount=0;                              // Number of ports in range
+    int m_wordCount=0;                                  // Number of bitmap words
+    bool m_randomStart=false;                           // == true start search at random port
+    QScopedArrayPointer<QAtomicInteger<quint64>> m_portMap; // Ports in use bitmap
+    QAtomicInteger<quint32> m_nextWord {0};             // Next word to start search from
+    QAtomicInteger<quint64> m_portsInUse {0};           // Ports currently allocated
+    QAtomicInteger<quint64> m_peakPortsInUse {0};       // Most ports allocated at once
+    QAtomicInteger<quint64> m_exhaustedCount {0};       // Acquires that found no free port
+
+};
+
+#endif // COGWHEELPASSIVEPORTS_H
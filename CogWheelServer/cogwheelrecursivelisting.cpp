@@ -0,0 +1,332 @@
+/*
+ * File:   cogwheelrecursivelisting.cpp
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+//
+// Class: CogWheelRecursiveListing
+//
+// Description: Class to produce a recursive LIST (LIST -R) or MLSD (SITE MLSDR)
+// listing of a whole directory tree over a single data connection. Directories are
+// listed depth first (as ls -R does); each is preceded by a header ("path:" for LIST,
+// a cdir fact line for MLSD). While one directory is being sent the next few waiting
+// are read and formatted in the background on a shared thread pool, with the amount
+// held per directory capped. The number of directories waiting is capped too so
+// memory stays bounded; if the cap is reached the transfer fails (451) rather than
+// leave part of the tree out. Symbolic links to directories are not followed.
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheelrecursivelisting.h"
+#include "cogwheelftpcoreutil.h"
+#include "cogwheellogger.h"
+
+#include <QRunnable>
+
+//
+// Background directory read task. Reads and formats up to the prefetch cap of
+// a queued directory's entries then signals the listing. The scan is left alone
+// if the listing has gone.
+//
+
+class CogWheelDirectoryPrefetchTask : public QRunnable
+{
+
+public:
+
+    CogWheelDirectoryPrefetchTask(QSharedPointer<CogWheelRecursiveListing::DirectoryScan> scan)
+        : m_scan(scan) { }
+
+    void run() override
+    {
+
+        QByteArray listing;
+
+        m_scan->mutex.lock();
+        bool abandoned = m_scan->abandoned;
+        m_scan->mutex.unlock();
+
+        if (!abandoned) {
+            CogWheelRecursiveListing::readEntries(*m_scan, listing, kCWRecursiveListingPrefetchBytes);
+        }
+
+        QMutexLocker scanLock { &m_scan->mutex };
+
+        m_scan->listing = listing;
+        m_scan->readFinished = true;
+        m_scan->readDone.wakeAll();
+
+    }
+
+private:
+    QSharedPointer<CogWheelRecursiveListing::DirectoryScan> m_scan;  // Directory to read
+
+};
+
+// ====================
+// CLASS IMPLEMENTATION
+// ====================
+
+// Shared background directory read pool
+
+QThreadPool CogWheelRecursiveListing::m_prefetchPool;
+
+/**
+ * @brief CogWheelRecursiveListing::CogWheelRecursiveListing
+ *
+ * Queue top level directory for listing.
+ *
+ * @param path          Local directory path.
+ * @param listPath      Client directory path (for headers).
+ * @param format        Listing line format (LIST or MLSD).
+ * @param facts         Facts selected for MLSD.
+ */
+CogWheelRecursiveListing::CogWheelRecursiveListing(const QString &path, const QString &listPath, ListingFormat format,
+                                                   quint32 facts)
+    : CogWheelDirectoryListing(format, facts)
+{
+
+    QSharedPointer<DirectoryScan> scan { new DirectoryScan() };
+
+    scan->path = path;
+    scan->listPath = listPath.toUtf8();
+    scan->format = format;
+    scan->facts = facts;
+
+    CogWheelDirectoryScanner::statFile(path, scan->pathStat, facts);
+
+    m_pending.append(scan);
+
+    prefetchDirectories();
+
+}
+
+/**
+ * @brief CogWheelRecursiveListing::~CogWheelRecursiveListing
+ *
+ * Destructor. Mark any directories still queued for background read
+ * as abandoned so the read is skipped.
+ *
+ */
+CogWheelRecursiveListing::~CogWheelRecursiveListing()
+{
+
+    for (auto scan : m_pending) {
+        QMutexLocker scanLock { &scan->mutex };
+        scan->abandoned = true;
+    }
+
+}
+
+/**
+ * @brief CogWheelRecursiveListing::readEntries
+ *
+ * Read directory entries, appending their listing lines to chunk until it
+ * reaches the maximum size or the directory is complete. Sub-directories
+ * found (not . or .. or symbolic links) are added to the scans children
+ * up to the pending directory cap. Called on the connection thread or a
+ * background read thread but never both at once for the same scan.
+ *
+ * @param scan          Directory being read.
+ * @param chunk         Listing lines (UTF-8).
+ * @param maxChunkSize  Maximum chunk size in bytes.
+ */
+void CogWheelRecursiveListing::readEntries(DirectoryScan &scan, QByteArray &chunk, qint64 maxChunkSize)
+{
+
+    CogWheelFileStat fileStat;
+
+    if (scan.complete) {
+        return;
+    }
+
+    if (!scan.scanner) {
+        scan.scanner.reset(new CogWheelDirectoryScanner(scan.path, true, scannerFacts(scan.format, scan.facts)));
+    }
+
+    for (;;) {
+
+        if (chunk.size() >= maxChunkSize) {
+            return;
+        }
+
+        if (!scan.scanner->next(fileStat)) {
+            break;
+        }
+
+        appendEntry(chunk, scan.format, scan.facts, QByteArray(), fileStat);
+
+        if (fileStat.isDir && !fileStat.isSymLink && (fileStat.fileName!=".") && (fileStat.fileName!="..")) {
+            if (scan.children.size() >= kCWRecursiveListingMaxPending) {
+                scan.childrenDropped = true;
+                continue;
+            }
+            QSharedPointer<DirectoryScan> child { new DirectoryScan() };
+            child->path = scan.path+"/"+QString::fromUtf8(fileStat.fileName);
+            child->listPath = scan.listPath;
+            if (!child->listPath.endsWith('/')) {
+                child->listPath.append('/');
+            }
+            child->listPath.append(fileStat.fileName);
+            child->pathStat = fileStat;
+            child->format = scan.format;
+            child->facts = scan.facts;
+            scan.children.append(child);
+        }
+
+    }
+
+    scan.scanner.reset();
+    scan.complete = true;
+
+}
+
+/**
+ * @brief CogWheelRecursiveListing::prefetchDirectories
+ *
+ * Queue background reads for the next few directories waiting to be
+ * listed.
+ *
+ */
+void CogWheelRecursiveListing::prefetchDirectories()
+{
+
+    int prefetchCount=0;
+
+    for (int pending=m_pending.size()-1; pending >= 0; pending--) {
+        const QSharedPointer<DirectoryScan> &scan = m_pending.at(pending);
+        if (prefetchCount++ == kCWRecursiveListingPrefetch) {
+            break;
+        }
+        if (!scan->readQueued) {
+            scan->readQueued = true;
+            m_prefetchPool.start(new CogWheelDirectoryPrefetchTask(scan));
+        }
+    }
+
+}
+
+/**
+ * @brief CogWheelRecursiveListing::nextDirectory
+ *
+ * Start listing the next directory waiting; wait for its background read
+ * if one is running then append its header and any lines already read.
+ *
+ * @param chunk     Listing lines (UTF-8).
+ */
+void CogWheelRecursiveListing::nextDirectory(QByteArray &chunk)
+{
+
+    m_current = m_pending.takeLast();
+
+    prefetchDirectories();
+
+    if (m_current->readQueued) {
+        QMutexLocker scanLock { &m_current->mutex };
+        while (!m_current->readFinished) {
+            m_current->readDone.wait(&m_current->mutex);
+        }
+    }
+
+    if (m_current->format == LIST) {
+        if (!m_firstDirectory) {
+            chunk.append(kCWEOL);
+        }
+        chunk.append(m_current->listPath);
+        chunk.append(":");
+        chunk.append(kCWEOL);
+    } else {
+        CogWheelFTPCoreUtil::appendPathFactList(chunk, m_current->pathStat, m_current->listPath, m_current->facts);
+        chunk.append(kCWEOL);
+    }
+
+    m_firstDirectory = false;
+
+    chunk.append(m_current->listing);
+    m_current->listing.clear();
+
+}
+
+/**
+ * @brief CogWheelRecursiveListing::pushChildren
+ *
+ * Current directory is complete so its sub-directories are listed next (first
+ * one last in the pending list). If they would take the directories waiting
+ * past the cap the listing is marked as failed rather than silently leaving
+ * them out.
+ *
+ */
+void CogWheelRecursiveListing::pushChildren()
+{
+
+    int childCount = qMin(m_current->children.size(), kCWRecursiveListingMaxPending-m_pending.size());
+
+    if ((childCount < m_current->children.size()) || m_current->childrenDropped) {
+        cogWheelWarning("Recursive listing directory limit reached listing sub-directories of "+m_current->path+".");
+        setFailed(true);
+        m_current.reset();
+        return;
+    }
+
+    for (int child=childCount-1; child >= 0; child--) {
+        m_pending.append(m_current->children[child]);
+    }
+
+    m_current.reset();
+
+}
+
+/**
+ * @brief CogWheelRecursiveListing::nextChunk
+ *
+ * Build the next chunk of listing lines, moving on through the waiting
+ * directories until the chunk reaches the maximum size (the lines read in
+ * the background for a directory may take it over). When a directory is
+ * complete its sub-directories are listed next. If the directory limit is
+ * reached the listing fails (isFailed()) and false is returned.
+ *
+ * @param chunk         Returned UTF-8 listing lines.
+ * @param maxChunkSize  Maximum chunk size in bytes.
+ *
+ * @return  == false listing complete (chunk empty).
+ */
+bool CogWheelRecursiveListing::nextChunk(QByteArray &chunk, qint64 maxChunkSize)
+{
+
+    chunk.clear();
+    chunk.reserve(static_cast<int>(maxChunkSize)+kCWListingLineReserve);
+
+    while (chunk.size() < maxChunkSize) {
+
+        if (!m_current) {
+            if (m_pending.isEmpty()) {
+                break;
+            }
+            nextDirectory(chunk);
+        }
+
+        readEntries(*m_current, chunk, maxChunkSize);
+
+        if (m_current->complete) {
+            pushChildren();
+            if (isFailed()) {
+                chunk.clear();
+                return(false);
+            }
+            prefetchDirectories();
+        }
+
+    }
+
+    return(!chunk.isEmpty());
+
+}
@@ -0,0 +1,107 @@
+/*
+ * File:   cogwheelrecursivelisting.h
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+#ifndef COGWHEELRECURSIVELISTING_H
+#define COGWHEELRECURSIVELISTING_H
+
+//
+// Class: CogWheelRecursiveListing
+//
+// Description: Class to produce a recursive LIST (LIST -R) or MLSD (SITE MLSDR)
+// listing of a whole directory tree over a single data connection. Directories are
+// listed depth first (as ls -R does); each is preceded by a header ("path:" for LIST,
+// a cdir fact line for MLSD). While one directory is being sent the next few waiting
+// are read and formatted in the background on a shared thread pool, with the amount
+// held per directory capped. The number of directories waiting is capped too so
+// memory stays bounded; if the cap is reached the transfer fails (451) rather than
+// leave part of the tree out. Symbolic links to directories are not followed.
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheel.h"
+#include "cogwheeldirectorylisting.h"
+#include "cogwheeldirectoryscanner.h"
+
+#include <QVector>
+#include <QSharedPointer>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThreadPool>
+
+// =================
+// CLASS DECLARATION
+// =================
+
+class CogWheelRecursiveListing : public CogWheelDirectoryListing
+{
+
+public:
+
+    // Directory queued for listing (shared with its background read)
+
+    struct DirectoryScan {
+        QString path;                                       // Local directory path
+        QByteArray listPath;                                // Client directory path (UTF-8)
+        CogWheelFileStat pathStat;                          // Directory metadata (MLSD cdir)
+        ListingFormat format;                               // Listing line format
+        quint32 facts;                                      // Facts selected for MLSD
+        QScopedPointer<CogWheelDirectoryScanner> scanner;   // Directory scanner (null == not opened/complete)
+        bool complete=false;                                // == true all entries read
+        QByteArray listing;                                 // Lines read in background
+        QVector<QSharedPointer<DirectoryScan>> children;    // Sub-directories found
+        bool childrenDropped=false;                         // == true sub-directories past cap not kept
+        QMutex mutex;                                       // Background read state lock
+        QWaitCondition readDone;                            // Signalled when background read done
+        bool readQueued=false;                              // == true background read queued
+        bool readFinished=false;                            // == true background read done
+        bool abandoned=false;                               // == true listing gone
+    };
+
+    // Constructor / Destructor
+
+    CogWheelRecursiveListing(const QString &path, const QString &listPath, ListingFormat format,
+                             quint32 facts=kCWFactAll);
+    ~CogWheelRecursiveListing();
+
+    // Build next chunk of listing (false == listing complete)
+
+    bool nextChunk(QByteArray &chunk, qint64 maxChunkSize) override;
+
+    // Read directory entries into listing lines
+
+    static void readEntries(DirectoryScan &scan, QByteArray &chunk, qint64 maxChunkSize);
+
+private:
+
+    // Queue background reads for next directories
+
+    void prefetchDirectories();
+
+    // Start listing the next directory waiting
+
+    void nextDirectory(QByteArray &chunk);
+
+    // Directory listed so its sub-directories are next
+
+    void pushChildren();
+
+    QVector<QSharedPointer<DirectoryScan>> m_pending;   // Directories waiting to be listed (next last)
+    QSharedPointer<DirectoryScan> m_current;            // Directory being listed
+    bool m_firstDirectory=true;                         // == true no directory listed yet
+
+    static QThreadPool m_prefetchPool;                  // Shared background directory read pool
+
+};
+
+#endif // COGWHEELRECURSIVELISTING_H
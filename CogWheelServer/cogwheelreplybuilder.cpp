@@ -0,0 +1,128 @@
+/*
+ * File:   cogwheelreplybuilder.cpp
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+//
+// Class: CogWheelReplyBuilder
+//
+// Description: Class to assemble a complete (possibly multi-line) control channel
+// reply as UTF-8 in a single pre-sized buffer so that it can be sent to the client
+// with one write and flush instead of one per line. Lines are appended in order
+// and the reply is ended with its reply code line.
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheelreplybuilder.h"
+
+// ====================
+// CLASS IMPLEMENTATION
+// ====================
+
+/**
+ * @brief CogWheelReplyBuilder::CogWheelReplyBuilder
+ *
+ * Create empty reply with buffer reserved.
+ *
+ * @param reserveSize   Initial buffer size in bytes.
+ */
+CogWheelReplyBuilder::CogWheelReplyBuilder(int reserveSize)
+{
+    m_reply.reserve(reserveSize);
+}
+
+/**
+ * @brief CogWheelReplyBuilder::appendLine
+ *
+ * Append line to reply.
+ *
+ * @param line  Reply line (no end of line).
+ */
+void CogWheelReplyBuilder::appendLine(const QString &line)
+{
+    m_reply.append(line.toUtf8());
+    m_reply.append(kCWEOL);
+}
+
+/**
+ * @brief CogWheelReplyBuilder::appendLine
+ *
+ * Append line to reply.
+ *
+ * @param line  Reply line (no end of line, UTF-8).
+ */
+void CogWheelReplyBuilder::appendLine(const char *line)
+{
+    m_reply.append(line);
+    m_reply.append(kCWEOL);
+}
+
+/**
+ * @brief CogWheelReplyBuilder::lineBuffer
+ *
+ * Reply buffer for a line to be appended to directly (UTF-8); it must
+ * be completed with endLine().
+ *
+ * @return  Reply buffer.
+ */
+QByteArray &CogWheelReplyBuilder::lineBuffer()
+{
+    return(m_reply);
+}
+
+/**
+ * @brief CogWheelReplyBuilder::endLine
+ *
+ * End line appended directly to reply buffer.
+ *
+ */
+void CogWheelReplyBuilder::endLine()
+{
+    m_reply.append(kCWEOL);
+}
+
+/**
+ * @brief CogWheelReplyBuilder::appendReplyCode
+ *
+ * Append final reply code line with its message.
+ *
+ * @param replyCode     Numeric reply code.
+ * @param message       Message.
+ */
+void CogWheelReplyBuilder::appendReplyCode(quint16 replyCode, const QString &message)
+{
+    m_reply.append(QByteArray::number(replyCode));
+    m_reply.append(' ');
+    m_reply.append(message.toUtf8());
+    m_reply.append(kCWEOL);
+}
+
+/**
+ * @brief CogWheelReplyBuilder::reply
+ *
+ * @return  Assembled reply (UTF-8).
+ */
+const QByteArray &CogWheelReplyBuilder::reply() const
+{
+    return(m_reply);
+}
+
+/**
+ * @brief CogWheelReplyBuilder::clear
+ *
+ * Empty reply; the buffer was reserved so it is kept for the next reply.
+ *
+ */
+void CogWheelReplyBuilder::clear()
+{
+    m_reply.truncate(0);
+}
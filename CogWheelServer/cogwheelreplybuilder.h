@@ -0,0 +1,74 @@
+/*
+ * File:   cogwheelreplybuilder.h
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+#ifndef COGWHEELREPLYBUILDER_H
+#define COGWHEELREPLYBUILDER_H
+
+//
+// Class: CogWheelReplyBuilder
+//
+// Description: Class to assemble a complete (possibly multi-line) control channel
+// reply as UTF-8 in a single pre-sized buffer so that it can be sent to the client
+// with one write and flush instead of one per line. Lines are appended in order
+// and the reply is ended with its reply code line.
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheel.h"
+
+#include <QString>
+#include <QByteArray>
+
+// =================
+// CLASS DECLARATION
+// =================
+
+class CogWheelReplyBuilder
+{
+
+public:
+
+    // Constructor
+
+    explicit CogWheelReplyBuilder(int reserveSize=kCWReplyReserve);
+
+    // Append a reply line (end of line added)
+
+    void appendLine(const QString &line);
+    void appendLine(const char *line);
+
+    // Append to current line directly then end it
+
+    QByteArray &lineBuffer();
+    void endLine();
+
+    // Append final reply code line
+
+    void appendReplyCode(quint16 replyCode, const QString &message);
+
+    // Assembled reply
+
+    const QByteArray &reply() const;
+
+    // Empty reply keeping its buffer for reuse
+
+    void clear();
+
+private:
+
+    QByteArray m_reply;     // Reply being assembled (UTF-8)
+
+};
+
+#endif // COGWHEELREPLYBUILDER_H
@@ -21,6 +21,11 @@
 // =============
 
 #include "cogwheelserver.h"
+#include "cogwheelfilereadahead.h"
+#include "cogwheelpassiveports.h"
+#include "cogwheelkerneltls.h"
+#include "cogwheellistingcache.h"
+#include "cogwheeldirectoryscanner.h"
 #include "cogwheellogger.h"
 
 // ====================
@@ -65,12 +70,44 @@ CogWheelServer::CogWheelServer(bool autoStart, QObject *parent) : QTcpServer(par
         cogWheelInfo("Server Global Name ["+m_serverSettings.serverGlobalName()+"]");
     }
 
+    // Resolve global name now and refresh it in the background
+
+    m_globalAddress.start(m_serverSettings.serverGlobalName(), m_serverSettings.serverGlobalNameRefresh());
+
     if (m_serverSettings.serverPassivePortLow()) {
         QString portLow { QString::number(m_serverSettings.serverPassivePortLow()) };
         QString portHigh { QString::number(m_serverSettings.serverPassivePortHigh()) };
         cogWheelInfo(static_cast<QString>("Server Passive Port Range: [")+portLow+" - "+portHigh+"]");
     }
 
+    // Load user directory (reloaded on settings change)
+
+    m_userDirectory.start();
+
+    // Setup passive port allocator
+
+    CogWheelPassivePorts::getInstance().setRange(m_serverSettings.serverPassivePortLow(),
+                                                 m_serverSettings.serverPassivePortHigh(),
+                                                 m_serverSettings.serverPassivePortRandom());
+
+    // Size download read ahead pool
+
+    CogWheelFileReadAhead::setThreadCount(m_serverSettings.serverReadAheadThreads());
+
+    // Setup directory listing cache
+
+    CogWheelListingCache::getInstance().setup(m_serverSettings.serverListingCacheSize());
+
+    // Size listing parallel stat pool
+
+    CogWheelDirectoryScanner::setStatThreadCount(m_serverSettings.serverListingStatThreads());
+
+    // Setup kernel TLS for encrypted downloads (falls back to QSslSocket)
+
+    if (m_serverSettings.serverSslEnabled() && m_serverSettings.serverKernelTLSEnabled()) {
+        CogWheelKernelTLS::setup(m_serverSettings.serverPrivateKey(), m_serverSettings.serverCert());
+    }
+
     // Setup server settings
 
     m_connections.setServerSettings (m_serverSettings);
@@ -103,6 +140,17 @@ void CogWheelServer::startServer()
 {
     cogWheelInfo("CogWheel FTP Server started.");
 
+    // Accept on every connection thread using SO_REUSEPORT listeners if enabled
+
+    if (m_serverSettings.serverReusePortEnabled()) {
+        if (m_connections.startListeners(m_serverSettings.serverPort())) {
+            cogWheelInfo("CogWheel Server listening on port "+QString::number(m_serverSettings.serverPort())+" on all connection threads.");
+            setRunning(true);
+            return;
+        }
+        cogWheelWarning("SO_REUSEPORT listeners could not be started so using single listener.");
+    }
+
     if (listen(QHostAddress::Any, m_serverSettings.serverPort())) {
         cogWheelInfo("CogWheel Server listening on port "+QString::number(m_serverSettings.serverPort()));
         connect(this,&CogWheelServer::accept, &m_connections, &CogWheelConnections::acceptConnection);
@@ -126,6 +174,7 @@ void CogWheelServer::stopServer()
 
     setRunning(false);
 
+    m_connections.stopListeners();
     m_connections.closeAll();
 
 }
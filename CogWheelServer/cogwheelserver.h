@@ -27,6 +27,8 @@
 #include "cogwheelconnections.h"
 #include "cogwheelserversettings.h"
 #include "cogwheelftpcore.h"
+#include "cogwheelglobaladdress.h"
+#include "cogwheeluserdirectory.h"
 
 #include <QObject>
 #include <QTcpServer>
@@ -84,6 +86,8 @@ private:
     CogWheelConnections m_connections;          // Connections handler
     CogWheelServerSettings m_serverSettings;    // Server settings
     CogWheelFTPCore m_ftpServer;                // FTP server core
+    CogWheelGlobalAddress m_globalAddress;      // Cached server global address
+    CogWheelUserDirectory m_userDirectory;      // In memory user directory
     bool m_running=false;                       // == true server running
 
 };
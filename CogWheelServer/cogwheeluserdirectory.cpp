@@ -0,0 +1,167 @@
+/*
+ * File:   cogwheeluserdirectory.cpp
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+//
+// Class: CogWheelUserDirectory
+//
+// Description: Class to keep an in memory hash of all user settings so that
+// USER/PASS never have to read the settings file. The directory is loaded at
+// startup and reloaded whenever the settings file changes (the manager saving
+// a user); lookups from connection threads are guarded by a read/write lock.
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheeluserdirectory.h"
+#include "cogwheellogger.h"
+
+#include <QSettings>
+
+// ====================
+// CLASS IMPLEMENTATION
+// ====================
+
+// Directory lock and user name to settings hash
+
+QReadWriteLock CogWheelUserDirectory::m_directoryLock;
+QHash<QString, CogWheelUserSettings> CogWheelUserDirectory::m_users;
+
+/**
+ * @brief CogWheelUserDirectory::CogWheelUserDirectory
+ *
+ * Setup settings watcher and reload timer signals/slots.
+ *
+ * @param parent    Parent object.
+ */
+CogWheelUserDirectory::CogWheelUserDirectory(QObject *parent) : QObject(parent)
+{
+
+    m_reloadTimer.setSingleShot(true);
+
+    connect(&m_reloadTimer, &QTimer::timeout, this, &CogWheelUserDirectory::reload);
+    connect(&m_settingsWatcher, &QFileSystemWatcher::fileChanged, this, &CogWheelUserDirectory::settingsFileChanged);
+
+}
+
+/**
+ * @brief CogWheelUserDirectory::~CogWheelUserDirectory
+ *
+ * Destructor.
+ *
+ */
+CogWheelUserDirectory::~CogWheelUserDirectory()
+{
+
+}
+
+/**
+ * @brief CogWheelUserDirectory::start
+ *
+ * Load user directory and start watching the settings file.
+ *
+ */
+void CogWheelUserDirectory::start()
+{
+
+    reload();
+
+    QSettings settings;
+
+    if (!m_settingsWatcher.files().contains(settings.fileName())) {
+        m_settingsWatcher.addPath(settings.fileName());
+    }
+
+}
+
+/**
+ * @brief CogWheelUserDirectory::findUser
+ *
+ * Find a user in the directory.
+ *
+ * @param userName      User name.
+ * @param userSettings  Returned user settings.
+ *
+ * @return  == true user found.
+ */
+bool CogWheelUserDirectory::findUser(const QString &userName, CogWheelUserSettings &userSettings)
+{
+
+    QReadLocker directoryLock { &m_directoryLock };
+
+    auto user = m_users.constFind(userName);
+
+    if (user == m_users.constEnd()) {
+        return(false);
+    }
+
+    userSettings = user.value();
+
+    return(true);
+
+}
+
+/**
+ * @brief CogWheelUserDirectory::settingsFileChanged
+ *
+ * Settings file changed slot function. The file is normally replaced
+ * on save so watch it again and reload once writes have settled.
+ *
+ * @param fileName  Settings file name.
+ */
+void CogWheelUserDirectory::settingsFileChanged(const QString &fileName)
+{
+
+    if (!m_settingsWatcher.files().contains(fileName)) {
+        m_settingsWatcher.addPath(fileName);
+    }
+
+    m_reloadTimer.start(kCWUserDirectoryReloadDelay);
+
+}
+
+/**
+ * @brief CogWheelUserDirectory::reload
+ *
+ * Read all users (and any anonymous user settings) from the settings
+ * file into a new hash and then swap it in.
+ *
+ */
+void CogWheelUserDirectory::reload()
+{
+
+    QHash<QString, CogWheelUserSettings> users;
+    QSettings userList;
+
+    userList.sync();
+
+    userList.beginGroup("UserList");
+    QStringList userNames { userList.value("users").toStringList() };
+    userList.endGroup();
+
+    users.reserve(userNames.size()+1);
+
+    for (const QString &userName : userNames) {
+        users[userName].load(userList, userName);
+    }
+
+    if (userList.childGroups().contains("anonymous")) {
+        users["anonymous"].load(userList, "anonymous");
+    }
+
+    m_directoryLock.lockForWrite();
+    m_users.swap(users);
+    m_directoryLock.unlock();
+
+    cogWheelInfo("User directory loaded with "+QString::number(userNames.size())+" users.");
+
+}
@@ -0,0 +1,85 @@
+/*
+ * File:   cogwheeluserdirectory.h
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+#ifndef COGWHEELUSERDIRECTORY_H
+#define COGWHEELUSERDIRECTORY_H
+
+//
+// Class: CogWheelUserDirectory
+//
+// Description: Class to keep an in memory hash of all user settings so that
+// USER/PASS never have to read the settings file. The directory is loaded at
+// startup and reloaded whenever the settings file changes (the manager saving
+// a user); lookups from connection threads are guarded by a read/write lock.
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheel.h"
+#include "cogwheelusersettings.h"
+
+#include <QObject>
+#include <QHash>
+#include <QTimer>
+#include <QReadWriteLock>
+#include <QFileSystemWatcher>
+
+// =================
+// CLASS DECLARATION
+// =================
+
+class CogWheelUserDirectory : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    // Class exception
+
+    struct Exception : public std::runtime_error {
+
+        Exception(const QString & messageStr)
+            : std::runtime_error(static_cast<QString>("CogWheelUserDirectory Failure: " + messageStr).toStdString()) {
+        }
+
+    };
+
+    // Constructor / Destructor
+
+    explicit CogWheelUserDirectory(QObject *parent = nullptr);
+    ~CogWheelUserDirectory();
+
+    // Load directory and watch for settings changes
+
+    void start();
+
+    // Find user (returns false if user does not exist)
+
+    static bool findUser(const QString &userName, CogWheelUserSettings &userSettings);
+
+private slots:
+
+    void settingsFileChanged(const QString &fileName);  // Settings file changed
+    void reload();                                      // Reload directory
+
+private:
+
+    QFileSystemWatcher m_settingsWatcher;   // Settings file watcher
+    QTimer m_reloadTimer;                   // Delay reload until writes settle
+
+    static QReadWriteLock m_directoryLock;                  // Directory lock
+    static QHash<QString, CogWheelUserSettings> m_users;    // User name to settings
+
+};
+
+#endif // COGWHEELUSERDIRECTORY_H
@@ -34,6 +34,10 @@
 #include <QLockFile>
 #include <QDir>
 
+#ifdef Q_OS_UNIX
+#include <csignal>
+#endif
+
 // ===============
 // LOCAL FUNCTIONS
 // ===============
@@ -65,6 +69,15 @@ int main(int argc, char *argv[])
 {
     QCoreApplication cogWheelServerApplication(argc, argv);
 
+#ifdef Q_OS_UNIX
+
+    // Writes direct to a data channel socket (sendfile()) closed by the client
+    // raise SIGPIPE so ignore it and let the write fail with EPIPE instead.
+
+    std::signal(SIGPIPE, SIG_IGN);
+
+#endif
+
     if  (!alreadyRunning()) {
 
         try {
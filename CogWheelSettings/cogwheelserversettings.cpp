@@ -54,6 +54,9 @@ void CogWheelServerSettings::load()
     if (!server.childKeys().contains("writesize")) {
         server.setValue("writesize", kCWWriteBytesSize);
     }
+    if (!server.childKeys().contains("writewindow")) {
+        server.setValue("writewindow", kCWWriteWindowSize);
+    }
     if (!server.childKeys().contains("enabled")) {
         server.setValue("enabled", true);
     }
@@ -93,6 +96,36 @@ void CogWheelServerSettings::load()
     if (!server.childKeys().contains("passiveporthigh")) {
         server.setValue("passiveporthigh", 0);
     }
+    if (!server.childKeys().contains("readaheadthreads")) {
+        server.setValue("readaheadthreads", kCWReadAheadThreads);
+    }
+    if (!server.childKeys().contains("sendfile")) {
+        server.setValue("sendfile", true);
+    }
+    if (!server.childKeys().contains("globalnamerefresh")) {
+        server.setValue("globalnamerefresh", kCWGlobalNameRefresh);
+    }
+    if (!server.childKeys().contains("passiveportrandom")) {
+        server.setValue("passiveportrandom", true);
+    }
+    if (!server.childKeys().contains("reuseport")) {
+        server.setValue("reuseport", false);
+    }
+    if (!server.childKeys().contains("connectionthreads")) {
+        server.setValue("connectionthreads", 0);
+    }
+    if (!server.childKeys().contains("listingcachesize")) {
+        server.setValue("listingcachesize", kCWListingCacheSize);
+    }
+    if (!server.childKeys().contains("listingstatthreads")) {
+        server.setValue("listingstatthreads", kCWListingStatThreads);
+    }
+    if (!server.childKeys().contains("ktlsenabled")) {
+        server.setValue("ktlsenabled", false);
+    }
+    if (!server.childKeys().contains("datachanneltimeout")) {
+        server.setValue("datachanneltimeout", kCWDataChannelTimeout);
+    }
     server.endGroup();
 
     server.beginGroup("Server");
@@ -101,6 +134,7 @@ void CogWheelServerSettings::load()
     setServerPort(server.value("port").toInt());
     setServerAllowSMNT(server.value("allowSMNT").toBool());
     setServerWriteBytesSize(server.value("writesize").toInt()); // NO UI
+    setServerWriteWindowSize(server.value("writewindow").toInt()); // NO UI
     setServerEnabled(server.value("enabled").toBool());
     setServerSslEnabled(server.value("sslenabled").toBool());
     setServerPlainFTPEnabled(server.value("plain").toBool());
@@ -114,6 +148,16 @@ void CogWheelServerSettings::load()
     setServerGlobalName(server.value("globalservername").toString());
     setServerPassivePortLow(server.value("passiveportlow").toInt());
     setServerPassivePortHigh(server.value("passiveporthigh").toInt());
+    setServerReadAheadThreads(server.value("readaheadthreads").toInt()); // NO UI
+    setServerSendFileEnabled(server.value("sendfile").toBool()); // NO UI
+    setServerDataChannelTimeout(server.value("datachanneltimeout").toInt()); // NO UI
+    setServerConnectionThreads(server.value("connectionthreads").toInt()); // NO UI
+    setServerReusePortEnabled(server.value("reuseport").toBool()); // NO UI
+    setServerPassivePortRandom(server.value("passiveportrandom").toBool()); // NO UI
+    setServerGlobalNameRefresh(server.value("globalnamerefresh").toInt()); // NO UI
+    setServerKernelTLSEnabled(server.value("ktlsenabled").toBool()); // NO UI
+    setServerListingCacheSize(server.value("listingcachesize").toULongLong()); // NO UI
+    setServerListingStatThreads(server.value("listingstatthreads").toInt()); // NO UI
     server.endGroup();
 
 }
@@ -135,6 +179,7 @@ void CogWheelServerSettings::save()
     server.setValue("port", serverPort());
     server.setValue("allowSMNT", serverAllowSMNT());
     server.setValue("writesize", serverWriteBytesSize());
+    server.setValue("writewindow", serverWriteWindowSize());
     server.setValue("enabled", serverEnabled());
     server.setValue("sslenabled",serverSslEnabled());
     server.setValue("plain", serverPlainFTPEnabled());
@@ -147,6 +192,16 @@ void CogWheelServerSettings::save()
     server.setValue("globalservername",serverGlobalName());
     server.setValue("passiveportlow",serverPassivePortLow());
     server.setValue("passiveporthigh",serverPassivePortHigh());
+    server.setValue("readaheadthreads",serverReadAheadThreads());
+    server.setValue("sendfile",serverSendFileEnabled());
+    server.setValue("datachanneltimeout",serverDataChannelTimeout());
+    server.setValue("connectionthreads",serverConnectionThreads());
+    server.setValue("reuseport",serverReusePortEnabled());
+    server.setValue("passiveportrandom",serverPassivePortRandom());
+    server.setValue("globalnamerefresh",serverGlobalNameRefresh());
+    server.setValue("ktlsenabled",serverKernelTLSEnabled());
+    server.setValue("listingcachesize",serverListingCacheSize());
+    server.setValue("listingstatthreads",serverListingStatThreads());
     server.endGroup();
 
 }
@@ -176,6 +231,31 @@ bool CogWheelServerSettings::loadPrivateKeyAndCert()
        return(false);
     }
 
+    // Parse key and cert once into a configuration shared by all TLS sockets
+
+    QSslKey sslPrivateKey(m_serverPrivateKey, QSsl::Rsa, QSsl::Pem, QSsl::PrivateKey);
+    QSslCertificate sslCert(m_serverCert);
+
+    if (sslPrivateKey.isNull() || sslCert.isNull()) {
+        cogWheelError("Error parsing server private key/certificate.");
+        return(false);
+    }
+
+    QSslConfiguration sslConfiguration { QSslConfiguration::defaultConfiguration() };
+
+    sslConfiguration.setProtocol(QSsl::SecureProtocols);    // Use ony secure protocols
+    sslConfiguration.setCaCertificates(sslConfiguration.caCertificates() << sslCert);
+    sslConfiguration.setLocalCertificate(sslCert);
+    sslConfiguration.setPrivateKey(sslPrivateKey);
+
+    // No client certificates are requested; with the default (AutoVerifyPeer) the
+    // OpenSSL context is set to verify the peer without a session id context and
+    // every data channel session resumption is refused by the server.
+
+    sslConfiguration.setPeerVerifyMode(QSslSocket::VerifyNone);
+
+    m_serverSslConfiguration = sslConfiguration;
+
     return(true);
 
 }
@@ -274,6 +354,24 @@ void CogWheelServerSettings::setServerWriteBytesSize(const quint64 &writeBytesSi
     m_serverWriteBytesSize = writeBytesSize;
 }
 
+/**
+ * @brief CogWheelServerSettings::serverWriteWindowSize
+ * @return
+ */
+quint64 CogWheelServerSettings::serverWriteWindowSize() const
+{
+    return m_serverWriteWindowSize;
+}
+
+/**
+ * @brief CogWheelServerSettings::setServerWriteWindowSize
+ * @param serverWriteWindowSize
+ */
+void CogWheelServerSettings::setServerWriteWindowSize(const quint64 &serverWriteWindowSize)
+{
+    m_serverWriteWindowSize = serverWriteWindowSize;
+}
+
 /**
  * @brief CogWheelServerSettings::active
  * @return
@@ -332,6 +430,11 @@ void CogWheelServerSettings::setServerCert(const QByteArray &serverCert)
     m_serverCert = serverCert;
 }
 
+QSslConfiguration CogWheelServerSettings::serverSslConfiguration() const
+{
+    return m_serverSslConfiguration;
+}
+
 QString CogWheelServerSettings::serverKeyFileName() const
 {
     return m_serverKeyFileName;
@@ -432,5 +535,102 @@ void CogWheelServerSettings::setServerPassivePortHigh(const quint64 &serverPassi
     m_serverPassivePortHigh = serverPassivePortHigh;
 }
 
+int CogWheelServerSettings::serverReadAheadThreads() const
+{
+    return m_serverReadAheadThreads;
+}
+
+void CogWheelServerSettings::setServerReadAheadThreads(int serverReadAheadThreads)
+{
+    m_serverReadAheadThreads = serverReadAheadThreads;
+}
 
+bool CogWheelServerSettings::serverSendFileEnabled() const
+{
+    return m_serverSendFileEnabled;
+}
 
+void CogWheelServerSettings::setServerSendFileEnabled(bool serverSendFileEnabled)
+{
+    m_serverSendFileEnabled = serverSendFileEnabled;
+}
+
+int CogWheelServerSettings::serverDataChannelTimeout() const
+{
+    return m_serverDataChannelTimeout;
+}
+
+void CogWheelServerSettings::setServerDataChannelTimeout(int serverDataChannelTimeout)
+{
+    m_serverDataChannelTimeout = serverDataChannelTimeout;
+}
+
+int CogWheelServerSettings::serverConnectionThreads() const
+{
+    return m_serverConnectionThreads;
+}
+
+void CogWheelServerSettings::setServerConnectionThreads(int serverConnectionThreads)
+{
+    m_serverConnectionThreads = serverConnectionThreads;
+}
+
+bool CogWheelServerSettings::serverReusePortEnabled() const
+{
+    return m_serverReusePortEnabled;
+}
+
+void CogWheelServerSettings::setServerReusePortEnabled(bool serverReusePortEnabled)
+{
+    m_serverReusePortEnabled = serverReusePortEnabled;
+}
+
+bool CogWheelServerSettings::serverPassivePortRandom() const
+{
+    return m_serverPassivePortRandom;
+}
+
+void CogWheelServerSettings::setServerPassivePortRandom(bool serverPassivePortRandom)
+{
+    m_serverPassivePortRandom = serverPassivePortRandom;
+}
+
+int CogWheelServerSettings::serverGlobalNameRefresh() const
+{
+    return m_serverGlobalNameRefresh;
+}
+
+void CogWheelServerSettings::setServerGlobalNameRefresh(int serverGlobalNameRefresh)
+{
+    m_serverGlobalNameRefresh = serverGlobalNameRefresh;
+}
+
+bool CogWheelServerSettings::serverKernelTLSEnabled() const
+{
+    return m_serverKernelTLSEnabled;
+}
+
+void CogWheelServerSettings::setServerKernelTLSEnabled(bool serverKernelTLSEnabled)
+{
+    m_serverKernelTLSEnabled = serverKernelTLSEnabled;
+}
+
+quint64 CogWheelServerSettings::serverListingCacheSize() const
+{
+    return m_serverListingCacheSize;
+}
+
+void CogWheelServerSettings::setServerListingCacheSize(quint64 serverListingCacheSize)
+{
+    m_serverListingCacheSize = serverListingCacheSize;
+}
+
+int CogWheelServerSettings::serverListingStatThreads() const
+{
+    return m_serverListingStatThreads;
+}
+
+void CogWheelServerSettings::setServerListingStatThreads(int serverListingStatThreads)
+{
+    m_serverListingStatThreads = serverListingStatThreads;
+}
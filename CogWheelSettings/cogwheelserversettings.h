@@ -26,6 +26,10 @@
 
 #include <QSettings>
 #include <QFile>
+#include <QSslConfiguration>
+#include <QSslCertificate>
+#include <QSslKey>
+#include <QSslSocket>
 
 // =================
 // CLASS DECLARATION
@@ -77,6 +81,7 @@ public:
     void setServerPrivateKey(const QByteArray &serverPrivateKey);
     QByteArray serverCert() const;
     void setServerCert(const QByteArray &serverCert);
+    QSslConfiguration serverSslConfiguration() const;
     QString serverKeyFileName() const;
     void setServerKeyFileName(const QString &serverKeyFileName);
     QString serverCertFileName() const;
@@ -97,6 +102,28 @@ public:
     void setServerPassivePortLow(const quint64 &serverPassivePortLow);
     quint64 serverPassivePortHigh() const;
     void setServerPassivePortHigh(const quint64 &serverPassivePortHigh);
+    quint64 serverWriteWindowSize() const;
+    void setServerWriteWindowSize(const quint64 &serverWriteWindowSize);
+    int serverReadAheadThreads() const;
+    void setServerReadAheadThreads(int serverReadAheadThreads);
+    bool serverSendFileEnabled() const;
+    void setServerSendFileEnabled(bool serverSendFileEnabled);
+    int serverDataChannelTimeout() const;
+    void setServerDataChannelTimeout(int serverDataChannelTimeout);
+    int serverConnectionThreads() const;
+    void setServerConnectionThreads(int serverConnectionThreads);
+    bool serverReusePortEnabled() const;
+    void setServerReusePortEnabled(bool serverReusePortEnabled);
+    bool serverPassivePortRandom() const;
+    void setServerPassivePortRandom(bool serverPassivePortRandom);
+    int serverGlobalNameRefresh() const;
+    void setServerGlobalNameRefresh(int serverGlobalNameRefresh);
+    bool serverKernelTLSEnabled() const;
+    void setServerKernelTLSEnabled(bool serverKernelTLSEnabled);
+    quint64 serverListingCacheSize() const;
+    void setServerListingCacheSize(quint64 serverListingCacheSize);
+    int serverListingStatThreads() const;
+    void setServerListingStatThreads(int serverListingStatThreads);
 
 private:
 
@@ -105,6 +132,7 @@ private:
     bool m_serverAllowSMNT=false;                            // ==true allow SMNT command
     quint64 m_serverPort;                                    // Server connection port
     quint64 m_serverWriteBytesSize=kCWWriteBytesSize;        // No of bytes per write
+    quint64 m_serverWriteWindowSize=kCWWriteWindowSize;      // Max bytes queued on socket for download
     bool m_serverEnabled=false;                              // ==true Server enabled
     bool m_serverSslEnabled=false;                           // ==true TLS/SSL enabled
     bool m_servePlainFTPEnabled=false;                       // ==true Plain insecure FTP enabled
@@ -114,6 +142,16 @@ private:
     QString m_serverGlobalName;                              // Address of server outside NAT
     quint64 m_serverPassivePortLow=0;                        // Passive port low range
     quint64 m_serverPassivePortHigh=0;                       // Passice port high range
+    int m_serverReadAheadThreads=kCWReadAheadThreads;        // Download read ahead threads (0 == off)
+    bool m_serverSendFileEnabled=true;                       // == true use sendfile() for plain downloads
+    int m_serverDataChannelTimeout=kCWDataChannelTimeout;    // Data channel connect timeout seconds
+    int m_serverConnectionThreads=0;                         // Connection threads (0 == no. of CPU cores)
+    bool m_serverReusePortEnabled=false;                     // == true SO_REUSEPORT listener per connection thread
+    bool m_serverPassivePortRandom=true;                     // == true random passive port search start
+    int m_serverGlobalNameRefresh=kCWGlobalNameRefresh;      // Global name refresh seconds (0 == never)
+    bool m_serverKernelTLSEnabled=false;                     // == true kernel TLS for encrypted downloads
+    quint64 m_serverListingCacheSize=kCWListingCacheSize;    // Listing cache memory cap bytes (0 == off)
+    int m_serverListingStatThreads=kCWListingStatThreads;    // Listing parallel stat threads (0 == off)
 
     quint64 m_connectionListUpdateTime=kCWConnListUpdateTime;// Connection list update timer
     bool m_serverLoggingEnabled=false;                       // == true logging enabled
@@ -121,6 +159,7 @@ private:
     QString m_serverLoggingFileName;                         // Name of file to which logging output goes
     QByteArray m_serverPrivateKey;                           // Server private key
     QByteArray m_serverCert;                                 // Server Certificate
+    QSslConfiguration m_serverSslConfiguration;              // Parsed TLS configuration (shared)
 
 };
 #endif // COGWHEELSERVERSETTINGS_H
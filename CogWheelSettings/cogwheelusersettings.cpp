@@ -71,6 +71,22 @@ void CogWheelUserSettings::load(QString userName)
 
     QSettings  userSettings;
 
+    load(userSettings, userName);
+
+}
+
+/**
+ * @brief CogWheelUserSettings::load
+ *
+ * Load user from an already open settings object (used when
+ * loading many users at once).
+ *
+ * @param userSettings
+ * @param userName
+ */
+void CogWheelUserSettings::load(QSettings &userSettings, const QString &userName)
+{
+
     userSettings.beginGroup(userName);
     m_userName = userName;
     m_userPassword = userSettings.value("password").toString();
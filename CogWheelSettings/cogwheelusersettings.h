@@ -54,6 +54,7 @@ public:
     // Load and save settings
 
     void load(QString userName);
+    void load(QSettings &userSettings, const QString &userName);
     void save(QString userName);
 
     // Private data accessors
@@ -0,0 +1,21 @@
+#-------------------------------------------------
+#
+# Check NOOP/TYPE/PWD are handled without allocating
+#
+#-------------------------------------------------
+
+include(../../cogwheelserver.pri)
+
+QT += testlib
+
+TARGET = CogWheelCommandAllocTest
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+SOURCES += cogwheelcommandalloctest.cpp
+
+# operator new/delete are replaced with malloc()/free() ones in the test
+
+*-g++*: QMAKE_CXXFLAGS += -Wno-mismatched-new-delete
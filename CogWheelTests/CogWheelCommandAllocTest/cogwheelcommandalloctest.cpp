@@ -0,0 +1,312 @@
+/*
+ * File:   cogwheelcommandalloctest.cpp
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+//
+// Program: CogWheelCommandAllocTest
+//
+// Description: Check that once a connection has warmed up the frequent NOOP, TYPE
+// and PWD commands are parsed, performed and replied to without allocating any
+// memory. A control channel is opened on one end of a loopback connection; command
+// lines are written from the other and allocations counted across the control
+// channel's readyRead() handling (read, line split, verb/argument parse, perform and
+// reply). Allocations are counted by replacing operator new/delete and (on glibc,
+// as Qt containers use it directly) malloc()/realloc().
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheelcontrolchannel.h"
+#include "cogwheelftpcore.h"
+#include "cogwheelserversettings.h"
+
+#include <QtTest>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// ======================
+// ALLOCATION COUNTING
+// ======================
+
+static std::atomic<bool> gCountAllocations { false };   // == true count allocations
+static std::atomic<quint64> gAllocationCount { 0 };     // Allocations counted
+
+static inline void countAllocation()
+{
+    if (gCountAllocations.load(std::memory_order_relaxed)) {
+        gAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+#ifdef __GLIBC__
+
+extern "C" {
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *memory, size_t size);
+
+void *malloc(size_t size)
+{
+    countAllocation();
+    return(__libc_malloc(size));
+}
+
+void *calloc(size_t count, size_t size)
+{
+    countAllocation();
+    return(__libc_calloc(count, size));
+}
+
+void *realloc(void *memory, size_t size)
+{
+    countAllocation();
+    return(__libc_realloc(memory, size));
+}
+
+}
+
+#endif
+
+void *operator new(std::size_t size)
+{
+    countAllocation();
+    void *memory = std::malloc(size ? size : 1);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return(memory);
+}
+
+void *operator new[](std::size_t size)
+{
+    return(operator new(size));
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    std::free(memory);
+}
+
+#ifdef __cpp_sized_deallocation
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+#endif
+
+// =================
+// CLASS DECLARATION
+// =================
+
+// Listener that just keeps the handle of the connection accepted
+
+class CogWheelHandleListener : public QTcpServer
+{
+
+public:
+
+    qintptr m_handle=-1;        // Accepted connection socket handle
+
+protected:
+
+    void incomingConnection(qintptr handle) override {
+        m_handle = handle;
+    }
+
+};
+
+class CogWheelCommandAllocTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    void initTestCase();
+    void cleanupTestCase();
+
+    void commandIsAllocationFree_data();
+    void commandIsAllocationFree();
+
+private:
+
+    quint64 performCommand(const QByteArray &commandLine);
+    QByteArray readReply();
+
+    CogWheelFTPCore m_ftpCore;                      // Loads server reply tables
+    CogWheelHandleListener m_listener;              // Loopback listener
+    QTcpSocket m_client;                            // Client end of control channel
+    CogWheelControlChannel *m_connection=nullptr;   // Server end of control channel
+
+};
+
+// ====================
+// CLASS IMPLEMENTATION
+// ====================
+
+/**
+ * @brief CogWheelCommandAllocTest::initTestCase
+ *
+ * Open an authorised control channel over a loopback connection and read
+ * its greeting.
+ *
+ */
+void CogWheelCommandAllocTest::initTestCase()
+{
+
+    CogWheelServerSettings serverSettings;
+
+    serverSettings.setServerEnabled(true);
+
+    CogWheelFTPCore::setupServer(serverSettings);
+
+    QVERIFY(m_listener.listen(QHostAddress::LocalHost));
+
+    m_client.connectToHost(m_listener.serverAddress(), m_listener.serverPort());
+
+    QVERIFY(m_listener.waitForNewConnection(5000));
+    QVERIFY(m_client.waitForConnected(5000));
+
+    m_connection = new CogWheelControlChannel(serverSettings);
+    m_connection->openConnection(m_listener.m_handle);
+    m_connection->setAuthorized(true);
+    m_connection->setCurrentWorkingDirectory("/pub/files");
+
+    QVERIFY(readReply().startsWith("220 "));
+
+}
+
+/**
+ * @brief CogWheelCommandAllocTest::cleanupTestCase
+ */
+void CogWheelCommandAllocTest::cleanupTestCase()
+{
+    delete m_connection;
+}
+
+/**
+ * @brief CogWheelCommandAllocTest::commandIsAllocationFree_data
+ */
+void CogWheelCommandAllocTest::commandIsAllocationFree_data()
+{
+
+    QTest::addColumn<QByteArray>("commandLine");
+    QTest::addColumn<QByteArray>("reply");
+
+    QTest::newRow("NOOP") << QByteArray("NOOP\r\n") << QByteArray("200 ");
+    QTest::newRow("TYPE") << QByteArray("type I\r\n") << QByteArray("200 ");
+    QTest::newRow("PWD") << QByteArray("PWD\r\n") << QByteArray("257 \"/pub/files\"\r\n");
+
+}
+
+/**
+ * @brief CogWheelCommandAllocTest::commandIsAllocationFree
+ *
+ * Perform command a few times so that the reply and socket buffers have
+ * grown then check that performing it once more does not allocate.
+ *
+ */
+void CogWheelCommandAllocTest::commandIsAllocationFree()
+{
+
+    QFETCH(QByteArray, commandLine);
+    QFETCH(QByteArray, reply);
+
+    for (int warmUp=0; warmUp < 3; warmUp++) {
+        performCommand(commandLine);
+        QVERIFY(readReply().startsWith(reply));
+    }
+
+    quint64 allocations = performCommand(commandLine);
+
+    QVERIFY(readReply().startsWith(reply));
+    QCOMPARE(allocations, static_cast<quint64>(0));
+
+}
+
+/**
+ * @brief CogWheelCommandAllocTest::performCommand
+ *
+ * Send command line from client and wait for it to arrive at the control
+ * channel socket (its readyRead signal blocked so it is not handled yet).
+ * Then run the control channel's readyRead handling counting any allocations
+ * made (including writing the reply).
+ *
+ * @param commandLine   Command line (with end of line).
+ *
+ * @return  Number of allocations (~0 == command line not received).
+ */
+quint64 CogWheelCommandAllocTest::performCommand(const QByteArray &commandLine)
+{
+
+    QSslSocket *controlSocket = m_connection->controlChannelSocket();
+
+    m_client.write(commandLine);
+    m_client.flush();
+
+    controlSocket->blockSignals(true);
+    while ((controlSocket->bytesAvailable() < commandLine.size()) && controlSocket->waitForReadyRead(5000)) {
+    }
+    controlSocket->blockSignals(false);
+
+    if (controlSocket->bytesAvailable() < commandLine.size()) {
+        return(~static_cast<quint64>(0));
+    }
+
+    gAllocationCount = 0;
+    gCountAllocations = true;
+
+    m_connection->readyRead();
+
+    gCountAllocations = false;
+
+    return(gAllocationCount);
+
+}
+
+/**
+ * @brief CogWheelCommandAllocTest::readReply
+ *
+ * @return  Complete reply read by client.
+ */
+QByteArray CogWheelCommandAllocTest::readReply()
+{
+
+    QByteArray reply;
+
+    while (!reply.endsWith("\r\n") && m_client.waitForReadyRead(5000)) {
+        reply.append(m_client.readAll());
+    }
+
+    return(reply);
+
+}
+
+QTEST_GUILESS_MAIN(CogWheelCommandAllocTest)
+
+#include "cogwheelcommandalloctest.moc"
@@ -0,0 +1,15 @@
+#-------------------------------------------------
+#
+# LIST/MLSD line formatting benchmark (lines per second)
+#
+#-------------------------------------------------
+
+include(../../cogwheelserver.pri)
+
+TARGET = CogWheelListingBench
+CONFIG += console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+SOURCES += cogwheellistingbench.cpp
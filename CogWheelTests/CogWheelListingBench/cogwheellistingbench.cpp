@@ -0,0 +1,243 @@
+/*
+ * File:   cogwheellistingbench.cpp
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+//
+// Program: CogWheelListingBench
+//
+// Description: Compare LIST and MLSD line formatting in lines per second. The
+// previous formatters (QDateTime::toString, QString::number and justified QString
+// copies converted with toUtf8()) are kept here for reference and run against
+// appendLISTLine()/appendFileFactList() over the same set of synthetic entries.
+// Run with an optional entry count and seconds per run (defaults 1000 and 2).
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheelftpcoreutil.h"
+#include "cogwheelidnamecache.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QVector>
+
+#include <functional>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+// Listing chunk size used by the data channel
+
+constexpr const int kCWBenchChunkSize=64*1024;
+
+// ================================
+// PREVIOUS (QString) FORMATTERS
+// ================================
+
+static QString buildFilePermissions(const CogWheelFileStat &fileStat)
+{
+
+    char permissions[10];
+
+    permissions[0] = (fileStat.permissions & 0400) ? 'r' : '-';
+    permissions[1] = (fileStat.permissions & 0200) ? 'w' : '-';
+    permissions[2] = (fileStat.permissions & 0100) ? 'x' : '-';
+    permissions[3] = (fileStat.permissions & 0040) ? 'r' : '-';
+    permissions[4] = (fileStat.permissions & 0020) ? 'w' : '-';
+    permissions[5] = (fileStat.permissions & 0010) ? 'x' : '-';
+    permissions[6] = (fileStat.permissions & 0004) ? 'r' : '-';
+    permissions[7] = (fileStat.permissions & 0002) ? 'w' : '-';
+    permissions[8] = (fileStat.permissions & 0001) ? 'x' : '-';
+    permissions[9] = 0;
+
+    return(permissions);
+
+}
+
+static QString buildUnixModePermissions(const CogWheelFileStat &fileStat)
+{
+    return("0"+QString::number(fileStat.permissions & 0777,8));
+}
+
+static QString buildFileCommonFactList(const CogWheelFileStat &fileStat)
+{
+
+    QString factList;
+
+    factList.append(static_cast<QString>("Modify=")+QDateTime::fromMSecsSinceEpoch(fileStat.modifyTime).toString("yyyyMMddhhmmss;"));
+    factList.append(static_cast<QString>("Create=")+QDateTime::fromMSecsSinceEpoch(fileStat.createTime).toString("yyyyMMddhhmmss;"));
+    factList.append(static_cast<QString>("UNIX.mode=")+buildUnixModePermissions(fileStat)+";");
+    factList.append(static_cast<QString>("UNIX.owner=")+QString::number(fileStat.ownerId)+";");
+    factList.append(static_cast<QString>("UNIX.group=")+QString::number(fileStat.groupId)+";");
+    factList.append(static_cast<QString>("UNIX.ownername=")+CogWheelIdNameCache::getInstance().userName(fileStat.ownerId)+";");
+    factList.append(static_cast<QString>("UNIX.groupname=")+CogWheelIdNameCache::getInstance().groupName(fileStat.groupId)+";");
+
+    return factList;
+
+}
+
+static QString buildLISTLine(const CogWheelFileStat &fileStat, const QString &fileName)
+{
+
+    QChar   fileType= '-';
+    QString line;
+    QString ownerGroup;
+
+    if (fileStat.isSymLink) {
+        fileType = 'l';
+    } else if (fileStat.isDir){
+        fileType = 'd';
+    }
+
+    line.append(fileType+buildFilePermissions(fileStat)+" 1 ");
+
+    ownerGroup = CogWheelIdNameCache::getInstance().userName(fileStat.ownerId);
+    if(ownerGroup.isEmpty()) {
+        ownerGroup = "0";
+    }
+    line.append(ownerGroup.leftJustified(10,' ',true)+" ");
+
+    ownerGroup = CogWheelIdNameCache::getInstance().groupName(fileStat.groupId);
+    if(ownerGroup.isEmpty()) {
+        ownerGroup = "0";
+    }
+    line.append(ownerGroup.leftJustified(10,' ',true)+" ");
+
+    line.append(QString::number(fileStat.size).rightJustified(10,' ',true)+" ");
+    line.append(QDateTime::fromMSecsSinceEpoch(fileStat.modifyTime).toString("MMM dd hh:mm").rightJustified(12,' ',true)+" ");
+    line.append(fileName);
+
+    return(line);
+
+}
+
+static QString buildFileFactList(const CogWheelFileStat &fileStat, const QString &fileName)
+{
+
+    QString factList;
+
+    if(fileStat.isDir){
+        factList.append("Type=dir;");
+    }else {
+        factList.append((static_cast<QString>("Type=file;")+"Size=")+QString::number(fileStat.size)+";");
+    }
+
+    factList.append(buildFileCommonFactList(fileStat)+" "+fileName);
+
+    return factList;
+
+}
+
+// =================
+// BENCHMARK
+// =================
+
+/**
+ * @brief linesPerSecond
+ *
+ * Format all entries into listing chunks repeatedly for the given time.
+ *
+ * @param entryCount    Number of entries.
+ * @param seconds       Seconds to run for.
+ * @param appendLine    Append line for entry to chunk (without end of line).
+ *
+ * @return  Lines formatted per second.
+ */
+static double linesPerSecond(int entryCount, int seconds, const std::function<void(QByteArray &, int)> &appendLine)
+{
+
+    QByteArray chunk;
+    QElapsedTimer timer;
+    quint64 lineCount=0;
+
+    chunk.reserve(kCWBenchChunkSize+kCWListingLineReserve);
+
+    timer.start();
+
+    do {
+        for (int entry=0; entry < entryCount; entry++) {
+            appendLine(chunk, entry);
+            chunk.append(kCWEOL);
+            if (chunk.size() >= kCWBenchChunkSize) {
+                chunk.truncate(0);
+            }
+        }
+        lineCount += entryCount;
+    } while (timer.elapsed() < seconds*1000);
+
+    return(lineCount*1000.0/timer.elapsed());
+
+}
+
+// ============================
+// ===== MAIN ENTRY POINT =====
+// ============================
+
+int main(int argc, char *argv[])
+{
+
+    QCoreApplication cogWheelListingBench(argc, argv);
+    QTextStream output(stdout);
+
+    int entryCount = (argc > 1) ? QString(argv[1]).toInt() : 1000;
+    int seconds = (argc > 2) ? QString(argv[2]).toInt() : 2;
+
+    if ((entryCount <= 0) || (seconds <= 0)) {
+        output << "Usage: CogWheelListingBench [entries] [seconds]" << endl;
+        return(1);
+    }
+
+    // Synthetic entries owned by this user (so names come from the id cache)
+
+    QVector<CogWheelFileStat> fileStats(entryCount);
+    QVector<QString> fileNames(entryCount);
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    for (int entry=0; entry < entryCount; entry++) {
+        CogWheelFileStat &fileStat = fileStats[entry];
+        fileNames[entry] = "file_"+QString::number(entry)+((entry%3) ? ".txt" : ".tar.gz");
+        fileStat.fileName = fileNames[entry].toUtf8();
+        fileStat.isDir = (entry%10)==0;
+        fileStat.permissions = fileStat.isDir ? 0755 : 0644;
+        fileStat.size = static_cast<quint64>(entry)*7919;
+        fileStat.modifyTime = now-static_cast<qint64>(entry)*3600000;
+        fileStat.createTime = fileStat.modifyTime-86400000;
+#ifdef Q_OS_UNIX
+        fileStat.ownerId = ::getuid();
+        fileStat.groupId = ::getgid();
+#endif
+    }
+
+    double oldLIST = linesPerSecond(entryCount, seconds, [&](QByteArray &chunk, int entry) {
+        chunk.append(buildLISTLine(fileStats[entry], fileNames[entry]).toUtf8());
+    });
+    double newLIST = linesPerSecond(entryCount, seconds, [&](QByteArray &chunk, int entry) {
+        CogWheelFTPCoreUtil::appendLISTLine(chunk, fileStats[entry]);
+    });
+    double oldMLSD = linesPerSecond(entryCount, seconds, [&](QByteArray &chunk, int entry) {
+        chunk.append(buildFileFactList(fileStats[entry], fileNames[entry]).toUtf8());
+    });
+    double newMLSD = linesPerSecond(entryCount, seconds, [&](QByteArray &chunk, int entry) {
+        CogWheelFTPCoreUtil::appendFileFactList(chunk, fileStats[entry]);
+    });
+
+    output << "Entries: " << entryCount << endl;
+    output << "LIST QString formatter:      " << qRound64(oldLIST) << " lines/sec" << endl;
+    output << "LIST appendLISTLine:         " << qRound64(newLIST) << " lines/sec (x" << newLIST/oldLIST << ")" << endl;
+    output << "MLSD QString formatter:      " << qRound64(oldMLSD) << " lines/sec" << endl;
+    output << "MLSD appendFileFactList:     " << qRound64(newMLSD) << " lines/sec (x" << newMLSD/oldMLSD << ")" << endl;
+
+    return(0);
+
+}
@@ -0,0 +1,17 @@
+#-------------------------------------------------
+#
+# Check commands pipelined behind AUTH TLS are not run
+#
+#-------------------------------------------------
+
+include(../../cogwheelserver.pri)
+
+QT += testlib
+
+TARGET = CogWheelStartTLSTest
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+SOURCES += cogwheelstarttlstest.cpp
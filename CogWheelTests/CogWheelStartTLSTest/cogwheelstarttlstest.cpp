@@ -0,0 +1,167 @@
+/*
+ * File:   cogwheelstarttlstest.cpp
+ *
+ * Author: Robert Tizzard
+ *
+ * Created on August 10, 2017
+ *
+ * Copyright 2017.
+ *
+ */
+
+//
+// Program: CogWheelStartTLSTest
+//
+// Description: Check that commands sent in the clear in the same read as AUTH TLS
+// are thrown away and not run as if they had come over TLS (STARTTLS command
+// injection). A control channel is opened on one end of a loopback connection and
+// the pipelined commands are written from the other.
+//
+
+// =============
+// INCLUDE FILES
+// =============
+
+#include "cogwheelcontrolchannel.h"
+#include "cogwheelftpcore.h"
+#include "cogwheelserversettings.h"
+
+#include <QtTest>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+// =================
+// CLASS DECLARATION
+// =================
+
+// Listener that just keeps the handle of the connection accepted
+
+class CogWheelHandleListener : public QTcpServer
+{
+
+public:
+
+    qintptr m_handle=-1;        // Accepted connection socket handle
+
+protected:
+
+    void incomingConnection(qintptr handle) override {
+        m_handle = handle;
+    }
+
+};
+
+class CogWheelStartTLSTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    void initTestCase();
+    void cleanupTestCase();
+
+    void commandsAfterAuthTLSNotRun();
+
+private:
+
+    QByteArray readReply();
+
+    CogWheelFTPCore m_ftpCore;                      // Loads server reply tables
+    CogWheelHandleListener m_listener;              // Loopback listener
+    QTcpSocket m_client;                            // Client end of control channel
+    CogWheelControlChannel *m_connection=nullptr;   // Server end of control channel
+
+};
+
+// ====================
+// CLASS IMPLEMENTATION
+// ====================
+
+/**
+ * @brief CogWheelStartTLSTest::initTestCase
+ *
+ * Open a control channel over a loopback connection with TLS enabled
+ * and read its greeting.
+ *
+ */
+void CogWheelStartTLSTest::initTestCase()
+{
+
+    CogWheelServerSettings serverSettings;
+
+    serverSettings.setServerEnabled(true);
+    serverSettings.setServerSslEnabled(true);
+    serverSettings.setServerPlainFTPEnabled(true);
+
+    CogWheelFTPCore::setupServer(serverSettings);
+
+    QVERIFY(m_listener.listen(QHostAddress::LocalHost));
+
+    m_client.connectToHost(m_listener.serverAddress(), m_listener.serverPort());
+
+    QVERIFY(m_listener.waitForNewConnection(5000));
+    QVERIFY(m_client.waitForConnected(5000));
+
+    m_connection = new CogWheelControlChannel(serverSettings);
+    m_connection->openConnection(m_listener.m_handle);
+
+    QVERIFY(readReply().startsWith("220 "));
+
+}
+
+/**
+ * @brief CogWheelStartTLSTest::cleanupTestCase
+ */
+void CogWheelStartTLSTest::cleanupTestCase()
+{
+    delete m_connection;
+}
+
+/**
+ * @brief CogWheelStartTLSTest::commandsAfterAuthTLSNotRun
+ *
+ * Send AUTH TLS with USER/PASS/NOOP behind it in one write; only the 234
+ * reply may come back in the clear.
+ *
+ */
+void CogWheelStartTLSTest::commandsAfterAuthTLSNotRun()
+{
+
+    m_client.write("AUTH TLS\r\nUSER anonymous\r\nPASS guest\r\nNOOP\r\n");
+    m_client.flush();
+
+    QVERIFY(readReply().startsWith("234 "));
+
+    QTest::qWait(1000);
+
+    QCOMPARE(m_client.readAll(), QByteArray());
+    QVERIFY(m_connection->userName().isEmpty());
+    QVERIFY(!m_connection->isAuthorized());
+
+}
+
+/**
+ * @brief CogWheelStartTLSTest::readReply
+ *
+ * Wait (processing events so the control channel can run) for a complete
+ * reply line.
+ *
+ * @return  Complete reply read by client.
+ */
+QByteArray CogWheelStartTLSTest::readReply()
+{
+
+    QByteArray reply;
+
+    for (int wait=0; (wait < 50) && !reply.endsWith("\r\n"); wait++) {
+        QTest::qWait(100);
+        reply.append(m_client.readLine());
+    }
+
+    return(reply);
+
+}
+
+QTEST_GUILESS_MAIN(CogWheelStartTLSTest)
+
+#include "cogwheelstarttlstest.moc"
@@ -0,0 +1,11 @@
+#-------------------------------------------------
+#
+# CogWheel server tests and benchmarks (qmake && make check)
+#
+#-------------------------------------------------
+
+TEMPLATE = subdirs
+
+SUBDIRS += CogWheelCommandAllocTest \
+    CogWheelListingBench \
+    CogWheelStartTLSTest
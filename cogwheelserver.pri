@@ -0,0 +1,82 @@
+# Server sources (less main.cpp) shared by CogWheel.pro and the tests/benchmarks.
+
+QT += core
+QT += network
+QT += network-private
+QT -= gui
+
+CONFIG += c++11
+
+# The following define makes your compiler emit warnings if you use
+# any feature of Qt which as been marked deprecated (the exact warnings
+# depend on your compiler). Please consult the documentation of the
+# deprecated API in order to know how to port your code away from it.
+DEFINES += QT_DEPRECATED_WARNINGS
+
+# You can also make your code fail to compile if you use deprecated APIs.
+# In order to do so, uncomment the following line.
+# You can also select to disable deprecated APIs only up to a certain version of Qt.
+#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+SERVER = $$PWD/CogWheelServer
+SETTINGS = $$PWD/CogWheelSettings
+
+SOURCES += $$SERVER/cogwheelserver.cpp \
+    $$SERVER/cogwheeldatachannel.cpp \
+    $$SERVER/cogwheelftpcore.cpp \
+    $$SERVER/cogwheelconnections.cpp \
+    $$SETTINGS/cogwheelusersettings.cpp \
+    $$SERVER/cogwheelcontrolchannel.cpp \
+    $$SETTINGS/cogwheelserversettings.cpp \
+    $$SERVER/cogwheelcontroller.cpp \
+    $$SERVER/cogwheelftpcoreutil.cpp \
+    $$SERVER/cogwheelfilereadahead.cpp \
+    $$SERVER/cogwheellistener.cpp \
+    $$SERVER/cogwheelpassiveports.cpp \
+    $$SERVER/cogwheelglobaladdress.cpp \
+    $$SERVER/cogwheeluserdirectory.cpp \
+    $$SERVER/cogwheelkerneltls.cpp \
+    $$SERVER/cogwheeldirectorylisting.cpp \
+    $$SERVER/cogwheellistingcache.cpp \
+    $$SERVER/cogwheelidnamecache.cpp \
+    $$SERVER/cogwheeldirectoryscanner.cpp \
+    $$SERVER/cogwheelrecursivelisting.cpp \
+    $$SERVER/cogwheelreplybuilder.cpp
+
+HEADERS += $$SERVER/cogwheelserver.h \
+    $$SERVER/cogwheeldatachannel.h \
+    $$SERVER/cogwheelftpcore.h \
+    $$SERVER/cogwheelconnections.h \
+    $$SETTINGS/cogwheelusersettings.h \
+    $$SERVER/cogwheelcontrolchannel.h \
+    $$SETTINGS/cogwheelserversettings.h \
+    $$SERVER/cogwheelcontroller.h \
+    $$SERVER/cogwheellogger.h \
+    $$SERVER/cogwheel.h \
+    $$SERVER/cogwheelftpserverreply.h \
+    $$SERVER/cogwheelftpcoreutil.h \
+    $$SERVER/cogwheelfilereadahead.h \
+    $$SERVER/cogwheellistener.h \
+    $$SERVER/cogwheelpassiveports.h \
+    $$SERVER/cogwheelglobaladdress.h \
+    $$SERVER/cogwheeluserdirectory.h \
+    $$SERVER/cogwheelkerneltls.h \
+    $$SERVER/cogwheeldirectorylisting.h \
+    $$SERVER/cogwheellistingcache.h \
+    $$SERVER/cogwheelidnamecache.h \
+    $$SERVER/cogwheeldirectoryscanner.h \
+    $$SERVER/cogwheelrecursivelisting.h \
+    $$SERVER/cogwheelreplybuilder.h
+
+# Kernel TLS (kTLS) encrypted downloads need OpenSSL 3.0 on Linux; build
+# with "qmake CONFIG+=ktls" and set server setting ktlsenabled to true.
+
+ktls {
+    DEFINES += COGWHEEL_KTLS
+    LIBS += -lssl -lcrypto
+}
+
+INCLUDEPATH += $$SERVER/ \
+               $$SETTINGS/
+DEPENDPATH += $$SERVER/ \
+              $$SETTINGS/